@@ -10,6 +10,11 @@
  * Multiboot info
  */
 
+/** Flags telling which fields of the Multiboot information are valid */
+#define MULTIBOOT_INFO_MEMORY   0x00000001 /**< mem_lower and mem_upper */
+#define MULTIBOOT_INFO_MODS     0x00000008 /**< mods_count and mods_addr */
+#define MULTIBOOT_INFO_MEM_MAP  0x00000040 /**< mmap_length and mmap_addr */
+
 /** The Multiboot information */
 typedef struct multiboot_info
 {
@@ -20,6 +25,28 @@ typedef struct multiboot_info
   unsigned long cmdline;
   unsigned long mods_count;
   unsigned long mods_addr;
+  unsigned long syms[4];
+  unsigned long mmap_length;
+  unsigned long mmap_addr;
 } multiboot_info_t;
 
+/** Types of the memory map's regions */
+#define MULTIBOOT_MEMORY_AVAILABLE        1
+#define MULTIBOOT_MEMORY_RESERVED         2
+#define MULTIBOOT_MEMORY_ACPI_RECLAIMABLE 3
+#define MULTIBOOT_MEMORY_NVS              4
+#define MULTIBOOT_MEMORY_BADRAM           5
+
+/**
+ * An entry of the memory map. The size field does not count itself and
+ * may be larger than the structure, it gives the offset of the next one.
+ */
+typedef struct multiboot_memory_map
+{
+  unsigned long size;
+  unsigned long long base_address;
+  unsigned long long length;
+  unsigned long type;
+} __attribute__((packed)) multiboot_memory_map_t;
+
 #endif // _MULTIBOOT_H_
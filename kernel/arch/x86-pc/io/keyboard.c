@@ -105,34 +105,215 @@ char keymap[] = {
 0xFF,   0xFF,   0xFF,   0xFF    /*  (0x61)  */
 };
 
+/* Keymap columns */
+#define COLUMN_NORMAL	0
+#define COLUMN_SHIFT	1
+#define COLUMN_CTRL	2
+#define COLUMN_ALT	3
+
+#define KEYMAP_NB_SCANCODES (sizeof(keymap) / 4)
+
+/* Controller status */
+#define STATUS_OUTPUT_FULL	0x01
+#define STATUS_INPUT_FULL	0x02
+
+/* Bytes which are not key scancodes */
+#define SCANCODE_EXTENDED	0xe0
+#define SCANCODE_BREAK		0x80
+#define KEYBOARD_ACK		0xfa
+#define KEYBOARD_RESEND		0xfe
+
+/* Typematic rate: 30 characters/s after a delay of 250 ms */
+#define KEYBOARD_SET_TYPEMATIC	0xf3
+#define TYPEMATIC_FASTEST	0x00
+
+/* The controller holds at most a few bytes, bounds a batch anyway */
+#define KEYBOARD_BATCH_LENGTH	16
+
 static struct console *terminal;
 
-void keyboard_interrupt_handler(int number)
+static uint8_t modifiers;
+static bool_t extended;
+
+/* Scancodes translated to a key code whatever the modifiers are */
+static uchar_t special_key(uchar_t scancode)
 {
-	uchar_t status, scancode;
+	switch (scancode)
+	{
+		case KEY_SPACE:		return ' ';
+		case KEY_F1:		return KBD_F1;
+		case KEY_F2:		return KBD_F2;
+		case KEY_F3:		return KBD_F3;
+		case KEY_F4:		return KBD_F4;
+		case KEY_F5:		return KBD_F5;
+		case KEY_F6:		return KBD_F6;
+		case KEY_F7:		return KBD_F7;
+		case KEY_F8:		return KBD_F8;
+		case KEY_F9:		return KBD_F9;
+		case KEY_F10:		return KBD_F10;
+		case KEY_F11:		return KBD_F11;
+		case KEY_F12:		return KBD_F12;
+		case KEY_UP:		return KBD_UP;
+		case KEY_DOWN:		return KBD_DOWN;
+		case KEY_LEFT:		return KBD_LEFT;
+		case KEY_RIGHT:		return KBD_RIGHT;
+		case KEY_PAGE_UP:	return KBD_PAGE_UP;
+		case KEY_PAGE_DOWN:	return KBD_PAGE_DOWN;
+		case KEY_HOME:		return KBD_HOME;
+		case KEY_END:		return KBD_END;
+		case KEY_INSERT:	return KBD_INSERT;
+		case KEY_DELETE:	return KBD_DELETE;
+		default:		return 0;
+	}
+}
 
-	(void)number; // Avoid a useless warning ;-)
+/* Track the modifier keys, return TRUE if the scancode was one */
+static bool_t update_modifiers(uchar_t scancode, bool_t released)
+{
+	uint8_t modifier;
+
+	switch (scancode)
+	{
+		case KEY_LEFT_SHIFT:
+			modifier = extended ? 0 : KBD_MODIFIER_LEFT_SHIFT;
+			break;
+
+		case KEY_RIGHT_SHIFT:
+			modifier = extended ? 0 : KBD_MODIFIER_RIGHT_SHIFT;
+			break;
+
+		case KEY_LEFT_CTRL: /* Right control when extended */
+			modifier = KBD_MODIFIER_CTRL;
+			break;
+
+		case KEY_LEFT_ALT: /* Alt Gr when extended */
+			modifier = KBD_MODIFIER_ALT;
+			break;
+
+		case KEY_CAPS_LOCK:
+			if (!released)
+				modifiers ^= KBD_MODIFIER_CAPS_LOCK;
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
 
-	do
+	/* Fake shifts sent around extended keys are simply ignored */
+	if (released)
+		modifiers &= ~modifier;
+	else
+		modifiers |= modifier;
+
+	return TRUE;
+}
+
+/*
+ * Scancode set 1 state machine: returns the key code of a pressed key,
+ * or 0 for prefixes, releases and modifiers.
+ */
+static uchar_t decode(uchar_t scancode)
+{
+	bool_t released;
+	uchar_t key;
+	int column;
+
+	if (scancode == SCANCODE_EXTENDED)
 	{
-		status = inb(KEYBOARD_COMMAND_PORT);
-	} while((status & 0x01) == 0);
+		extended = TRUE;
+		return 0;
+	}
+
+	if (scancode == KEYBOARD_ACK || scancode == KEYBOARD_RESEND)
+		return 0;
 
-	scancode = inb(KEYBOARD_DATA_PORT);
+	released  = (scancode & SCANCODE_BREAK) != 0;
+	scancode &= ~SCANCODE_BREAK;
 
-	if (scancode < 0x80)
+	if (update_modifiers(scancode, released) || released)
 	{
-		console_add_character(terminal, scancode);
+		extended = FALSE;
+		return 0;
 	}
+
+	key = special_key(scancode);
+
+	if (!key && scancode < KEYMAP_NB_SCANCODES)
+	{
+		if (modifiers & KBD_MODIFIER_CTRL)
+			column = COLUMN_CTRL;
+		else if (modifiers & KBD_MODIFIER_ALT)
+			column = COLUMN_ALT;
+		else if (modifiers & KBD_MODIFIER_SHIFT)
+			column = COLUMN_SHIFT;
+		else
+			column = COLUMN_NORMAL;
+
+		key = keymap[scancode * 4 + column];
+
+		/* Caps lock only affects letters */
+		if ((modifiers & KBD_MODIFIER_CAPS_LOCK)
+			&& ((key >= 'a' && key <= 'z') || (key >= 'A' && key <= 'Z')))
+			key ^= 0x20;
+
+		if ((modifiers & KBD_MODIFIER_CTRL) && key >= 'a' && key <= 'z')
+			key &= 0x1f;
+
+		/* Unmapped */
+		if (key == 0xff)
+			key = 0;
+	}
+
+	extended = FALSE;
+
+	return key;
 }
 
-char keyboard_get_keymap(uchar_t i)
+void keyboard_interrupt_handler(int number)
 {
-	return keymap[i*4];
+	uchar_t batch[KEYBOARD_BATCH_LENGTH];
+	size_t n = 0;
+
+	(void)number; // Avoid a useless warning ;-)
+
+	/* The IRQ tells that a byte is there: no polling, only take
+	 * whatever is already buffered by the controller */
+	while (n < KEYBOARD_BATCH_LENGTH
+		&& (inb(KEYBOARD_COMMAND_PORT) & STATUS_OUTPUT_FULL))
+	{
+		uchar_t key = decode(inb(KEYBOARD_DATA_PORT));
+
+		if (key)
+			batch[n++] = key;
+	}
+
+	if (n)
+		console_add_characters(terminal, (const char *)batch, n);
+}
+
+uint8_t keyboard_get_modifiers(void)
+{
+	return modifiers;
+}
+
+static void send_to_keyboard(uchar_t byte)
+{
+	/* Wait until the controller can take a byte, only during setup */
+	while (inb(KEYBOARD_COMMAND_PORT) & STATUS_INPUT_FULL)
+		;
+
+	outb(KEYBOARD_DATA_PORT, byte);
 }
 
 void keyboard_setup(struct console *term)
 {
-	terminal = term;
+	terminal  = term;
+	modifiers = 0;
+	extended  = FALSE;
+
 	x86_irq_set_routine(IRQ_KEYBOARD, keyboard_interrupt_handler);
+
+	/* The acknowledges are dropped by the interrupt handler */
+	send_to_keyboard(KEYBOARD_SET_TYPEMATIC);
+	send_to_keyboard(TYPEMATIC_FASTEST);
 }
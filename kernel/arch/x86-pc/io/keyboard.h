@@ -17,9 +17,44 @@
 #define KEYBOARD_DATA_PORT      0x60
 #define KEYBOARD_COMMAND_PORT   0x64
 
+/*
+ * Key codes delivered to the console: ASCII for the characters,
+ * values above 0x80 for the other keys.
+ */
 #define KBD_CR_NL       0x0a
 #define KBD_BACKSPACE   0x08
 #define KBD_TABULATION  0x09
+#define KBD_ESCAPE      0x1b
+#define KBD_F1          0x81
+#define KBD_F2          0x82
+#define KBD_F3          0x83
+#define KBD_F4          0x84
+#define KBD_F5          0x85
+#define KBD_F6          0x86
+#define KBD_F7          0x87
+#define KBD_F8          0x88
+#define KBD_F9          0x89
+#define KBD_F10         0x8a
+#define KBD_F11         0x8b
+#define KBD_F12         0x8c
+#define KBD_UP          0x90
+#define KBD_DOWN        0x91
+#define KBD_LEFT        0x92
+#define KBD_RIGHT       0x93
+#define KBD_PAGE_UP     0x94
+#define KBD_PAGE_DOWN   0x95
+#define KBD_HOME        0x96
+#define KBD_END         0x97
+#define KBD_INSERT      0x98
+#define KBD_DELETE      0x99
+
+/* Modifier keys state */
+#define KBD_MODIFIER_LEFT_SHIFT  0x01
+#define KBD_MODIFIER_RIGHT_SHIFT 0x02
+#define KBD_MODIFIER_SHIFT       (KBD_MODIFIER_LEFT_SHIFT | KBD_MODIFIER_RIGHT_SHIFT)
+#define KBD_MODIFIER_CTRL        0x04
+#define KBD_MODIFIER_ALT         0x08
+#define KBD_MODIFIER_CAPS_LOCK   0x10
 
 // See scancodes at wiki.osdev.org/PS2/2_Keyboard
 #define KEY_ESCAPE      0x01
@@ -52,15 +87,20 @@
 #define KEY_RIGHT       0x4d
 #define KEY_PAGE_UP	0x49
 #define KEY_PAGE_DOWN	0x51
+#define KEY_HOME        0x47
+#define KEY_END         0x4f
+#define KEY_INSERT      0x52
+#define KEY_DELETE      0x53
 
-/** Handles keyboard
+/** Handles keyboard: decodes the scancodes and queues the key codes
  *
- * @param r Registers status during the interrupt
+ * @param number IRQ number
  */
 void keyboard_interrupt_handler(int number);
 
 void keyboard_setup(struct console *term);
 
-char keyboard_get_keymap(uchar_t i);
+/** Current state of the modifier keys (KBD_MODIFIER_*) */
+uint8_t keyboard_get_modifiers(void);
 
 #endif // _KEYBOARD_H_
@@ -0,0 +1,201 @@
+/**
+ * @license MIT License
+ *
+ * 16550 UART driver: reception and transmission are interrupt driven,
+ * the transmitter being fed from a ring buffer in FIFO sized bursts.
+ */
+
+#include <arch/x86/io-ports.h>
+#include <arch/x86/interrupts/irq.h>
+#include <lib/status.h>
+#include <lib/ring.h>
+
+#include "serial.h"
+
+/* Registers, as offsets from the base port */
+#define DATA		0	/* RBR (read), THR (write), DLL if DLAB */
+#define INTERRUPT_ENABLE	1	/* IER, DLM if DLAB */
+#define INTERRUPT_ID	2	/* IIR (read) */
+#define FIFO_CONTROL	2	/* FCR (write) */
+#define LINE_CONTROL	3	/* LCR */
+#define MODEM_CONTROL	4	/* MCR */
+#define LINE_STATUS	5	/* LSR */
+#define MODEM_STATUS	6	/* MSR */
+#define SCRATCH		7
+
+#define IER_RX_AVAILABLE	0x01
+#define IER_TX_EMPTY		0x02
+
+#define IIR_NO_INTERRUPT	0x01
+#define IIR_ID_MASK		0x0e
+#define IIR_MODEM_STATUS	0x00
+#define IIR_TX_EMPTY		0x02
+#define IIR_RX_AVAILABLE	0x04
+#define IIR_LINE_STATUS		0x06
+#define IIR_RX_TIMEOUT		0x0c
+
+/* Enable and clear both FIFOs, interrupt at 14 received bytes */
+#define FCR_SETUP		0xc7
+
+#define LCR_8N1			0x03
+#define LCR_DLAB		0x80
+
+/* DTR, RTS and OUT2 which gates the IRQ line */
+#define MCR_SETUP		0x0b
+
+#define LSR_DATA_READY		0x01
+#define LSR_TX_EMPTY		0x20
+
+/* Depth of the transmit FIFO */
+#define TX_FIFO_LENGTH		16
+
+#define UART_CLOCK		115200
+
+#define COM1(reg) (SERIAL_COM1_PORT + (reg))
+
+static struct console *terminal;
+static bool_t serial_ready = FALSE;
+
+static uchar_t tx_buffer[SERIAL_TX_BUFFER_LENGTH];
+static struct ring tx_ring;
+
+/* Copy of IER, the THRE interrupt is only enabled while sending */
+static uint8_t interrupt_enable;
+
+static void transmit_burst(void)
+{
+	uchar_t burst[TX_FIFO_LENGTH];
+	size_t i, n;
+
+	/* THRE means that the whole FIFO is empty */
+	n = ring_get(&tx_ring, burst, TX_FIFO_LENGTH, -1);
+
+	for (i = 0; i < n; i++)
+		outb(COM1(DATA), burst[i]);
+
+	if (ring_is_empty(&tx_ring))
+	{
+		interrupt_enable &= ~IER_TX_EMPTY;
+		outb(COM1(INTERRUPT_ENABLE), interrupt_enable);
+	}
+}
+
+static void receive_all(void)
+{
+	while (inb(COM1(LINE_STATUS)) & LSR_DATA_READY)
+	{
+		uchar_t c = inb(COM1(DATA));
+
+		if (terminal)
+			console_add_character(terminal, c);
+	}
+}
+
+void serial_interrupt_handler(int number)
+{
+	uint8_t id;
+
+	(void)number; // Avoid a useless warning ;-)
+
+	while (!((id = inb(COM1(INTERRUPT_ID))) & IIR_NO_INTERRUPT))
+	{
+		switch (id & IIR_ID_MASK)
+		{
+			case IIR_RX_AVAILABLE:
+			case IIR_RX_TIMEOUT:
+				receive_all();
+				break;
+
+			case IIR_TX_EMPTY:
+				transmit_burst();
+				break;
+
+			case IIR_LINE_STATUS:
+				(void)inb(COM1(LINE_STATUS));
+				break;
+
+			case IIR_MODEM_STATUS:
+				(void)inb(COM1(MODEM_STATUS));
+				break;
+		}
+	}
+}
+
+static void queue_character(uchar_t c)
+{
+	/* Full ring: IRQs are disabled here, so drain it by polling */
+	while (ring_count(&tx_ring) > tx_ring.mask)
+	{
+		while (!(inb(COM1(LINE_STATUS)) & LSR_TX_EMPTY))
+			;
+
+		transmit_burst();
+	}
+
+	ring_put(&tx_ring, c);
+}
+
+void serial_write_character(uchar_t c)
+{
+	uint32_t flags;
+
+	if (!serial_ready)
+		return;
+
+	/* Several threads may write: the ring has a single producer as
+	 * long as IRQs are disabled */
+	X86_IRQs_DISABLE(flags);
+
+	if (c == '\n')
+		queue_character('\r');
+
+	queue_character(c);
+
+	/* Enabling THRE raises an interrupt right away if the
+	 * transmitter is idle, which starts the transmission */
+	if (!(interrupt_enable & IER_TX_EMPTY))
+	{
+		interrupt_enable |= IER_TX_EMPTY;
+		outb(COM1(INTERRUPT_ENABLE), interrupt_enable);
+	}
+
+	X86_IRQs_ENABLE(flags);
+}
+
+ret_t serial_setup(struct console *term)
+{
+	uint16_t divisor = UART_CLOCK / SERIAL_BAUD_RATE;
+
+	/* No UART if the scratch register does not keep its value */
+	outb(COM1(SCRATCH), 0x5a);
+
+	if (inb(COM1(SCRATCH)) != 0x5a)
+		return -KERNEL_OPERATION_NOT_SUPPORTED;
+
+	terminal = term;
+	ring_init(&tx_ring, tx_buffer, SERIAL_TX_BUFFER_LENGTH);
+
+	outb(COM1(INTERRUPT_ENABLE), 0);
+
+	/* Line speed */
+	outb(COM1(LINE_CONTROL), LCR_DLAB);
+	outb(COM1(DATA), divisor & 0xff);
+	outb(COM1(INTERRUPT_ENABLE), (divisor >> 8) & 0xff);
+
+	outb(COM1(LINE_CONTROL), LCR_8N1);
+	outb(COM1(FIFO_CONTROL), FCR_SETUP);
+	outb(COM1(MODEM_CONTROL), MCR_SETUP);
+
+	/* Discard whatever was received before */
+	while (inb(COM1(LINE_STATUS)) & LSR_DATA_READY)
+		(void)inb(COM1(DATA));
+
+	x86_irq_set_routine(IRQ_COM1, serial_interrupt_handler);
+
+	interrupt_enable = IER_RX_AVAILABLE;
+	outb(COM1(INTERRUPT_ENABLE), interrupt_enable);
+
+	serial_ready = TRUE;
+
+	return KERNEL_OK;
+}
@@ -0,0 +1,44 @@
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+/**
+ * @file serial.h
+ * @license MIT License
+ *
+ * @see [en] http://wiki.osdev.org/Serial_Ports
+ * @see [en] National Semiconductor PC16550D datasheet
+ *
+ * Interrupt driven 16550 UART on COM1
+ */
+
+#include <io/console.h>
+#include <lib/types.h>
+
+#define SERIAL_COM1_PORT	0x3f8
+
+/** Line speed, the UART clock being 115200 Hz */
+#define SERIAL_BAUD_RATE	115200
+
+/** Size of the transmit ring buffer, MUST be a power of 2 */
+#define SERIAL_TX_BUFFER_LENGTH	1024
+
+/**
+ * Setup COM1 (115200 bauds, 8N1, FIFOs enabled) and its IRQ
+ *
+ * @param term Console receiving the incoming characters
+ * @return KERNEL_OK, or -KERNEL_OPERATION_NOT_SUPPORTED without UART
+ */
+ret_t serial_setup(struct console *term);
+
+/**
+ * Queue a character for transmission, '\n' is sent as "\r\n".
+ * Does nothing until serial_setup() succeeded.
+ *
+ * @param c The character
+ */
+void serial_write_character(uchar_t c);
+
+/** Handles COM1's received data and transmitter empty interrupts */
+void serial_interrupt_handler(int number);
+
+#endif // _SERIAL_H_
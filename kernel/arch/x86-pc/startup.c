@@ -9,15 +9,23 @@
 #include <lib/status.h>
 #include <arch/x86-pc/io/vga.h>
 #include <arch/x86/mmu/gdt.h>
+#include <arch/x86/mmu/paging.h>
+#include <arch/x86/mmu/tss.h>
 #include <arch/x86/interrupts/idt.h>
 #include <arch/x86/interrupts/isr.h>
 #include <arch/x86/interrupts/irq.h>
+#include <arch/x86/threading/fpu.h>
 #include <arch/x86-pc/timer/pit.h>
+#include <arch/x86-pc/timer/clock.h>
+#include <arch/x86-pc/io/keyboard.h>
+#include <arch/x86-pc/io/serial.h>
 #include <lib/libc.h>
 #include <arch/x86-pc/bootstrap/multiboot.h>
 #include <memory/physical-memory.h>
 #include <threading/thread.h>
+#include <threading/stack.h>
 #include <threading/scheduler.h>
+#include <threading/timer.h>
 #include <io/console.h>
 #include <colorforth/colorforth.h>
 
@@ -27,7 +35,6 @@
  */
 void roentgenium_main(uint32_t magic, uint32_t address)
 {
-    uint16_t retval;
     multiboot_info_t *mbi;
     mbi = (multiboot_info_t *)address;
 
@@ -43,43 +50,66 @@ void roentgenium_main(uint32_t magic, uint32_t address)
     // GDT
     x86_gdt_setup();
 
+    // TSS: receives the CPU state when a task handles an exception
+    x86_tss_setup();
+
     // IDT
     x86_idt_setup();
 
     // ISRs: Exceptions
     x86_isr_setup();
 
+    // FPU and SSE, switched lazily between the threads by the #NM handler
+    x86_fpu_setup();
+
     // IRQs
     x86_irq_setup();
 
-    // Timer: Raise IRQ0 at 100 Hz rate
-    retval = x86_pit_set_frequency(100);
-
-    assert(retval == KERNEL_OK);
-
-    // Timer interrupt
+    // Timer interrupt: the scheduler arms the one-shot PIT for its next
+    // event, there are no periodic ticks
     x86_irq_set_routine(IRQ_TIMER, timer_interrupt_handler);
 
+    // Monotonic clock: calibrate the TSC against the PIT channel 2
+    clock_setup();
+
     // Initrd: Initial Ram Disk
     initrd_start = *((uint32_t *)mbi->mods_addr);
     initrd_end   = *(uint32_t *)(mbi->mods_addr + 4);
 
     // Physical memory management
-    physical_memory_setup((mbi->mem_upper<<10) + (1<<20),
-		    initrd_start,
-		    initrd_end);
+    physical_memory_setup(mbi, initrd_start, initrd_end);
 
-    // Kernel threads
-    threading_setup();
+    // Paging: identity mapping of the RAM with 4 MiB pages
+    x86_paging_setup(physical_memory_get_ram_end());
+
+    // Kernel threads' stacks, with guard pages and committed on demand
+    stack_setup();
 
     // Scheduler
     scheduler_setup();
 
+    // Kernel threads
+    threading_setup();
+
     // Enable interrupts
     asm volatile("sti");
 
+    // Timers, their callbacks run in a kernel thread
+    timer_wheel_setup();
+
+    // The page faults growing the stacks consume frames set aside, the
+    // timers thread refills them once they run low
+    stack_refill_setup();
+
     // Console
     console_setup(&cons, vga_display_character);
+    keyboard_setup(cons);
+
+    // COM1 mirrors printf() and types into the editor's console like the
+    // keyboard. Two producers on its ring are fine: both are IRQ handlers
+    // behind interrupt gates, so one never runs in the middle of the other.
+    if (serial_setup(cons) != KERNEL_OK)
+	printf("No UART on COM1, no serial console\n");
 
     // colorForth
     colorforth_initialize();
@@ -0,0 +1,104 @@
+#include <lib/libc.h>
+
+#include "pit.h"
+#include "clock.h"
+
+/* Calibration runs, the shortest measure is kept */
+#define CALIBRATION_RUNS 3
+#define CALIBRATION_US   10000
+
+/* CPUID.1:EDX, time stamp counter */
+#define CPUID_FEATURE_TSC (1 << 4)
+
+/* Nanoseconds per TSC cycle, as a fixed point number */
+#define CLOCK_SHIFT 22
+static uint32_t clock_mult;
+
+static uint64_t tsc_base;
+static uint32_t tsc_khz;
+
+
+static uint32_t cpuid_features(void)
+{
+	uint32_t eax = 1, ebx, ecx, edx;
+
+	asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+	return edx;
+}
+
+static inline uint64_t read_tsc(void)
+{
+	uint64_t tsc;
+
+	asm volatile("rdtsc" : "=A"(tsc));
+	return tsc;
+}
+
+/* TSC cycles during a one-shot of the PIT channel 2, in kHz */
+static uint32_t measure_tsc_khz(void)
+{
+	uint64_t start, cycles;
+	uint32_t duration_ns;
+
+	duration_ns = x86_pit_channel2_start(CALIBRATION_US);
+	start = read_tsc();
+
+	while (!x86_pit_channel2_expired())
+		;
+
+	cycles = read_tsc() - start;
+
+	return (uint32_t)udiv64(cycles * 1000000, duration_ns, NULL);
+}
+
+void clock_setup(void)
+{
+	uint32_t run, khz;
+
+	tsc_khz = 0;
+
+	if (!(cpuid_features() & CPUID_FEATURE_TSC))
+		return;
+
+	/* An interruption only lengthens a measure */
+	for (run = 0; run < CALIBRATION_RUNS; run++)
+	{
+		khz = measure_tsc_khz();
+
+		if (tsc_khz == 0 || khz < tsc_khz)
+			tsc_khz = khz;
+	}
+
+	/* Below 1 MHz the multiplier would not fit in 32 bits */
+	if (tsc_khz < 1000)
+	{
+		tsc_khz = 0;
+		return;
+	}
+
+	clock_mult = (uint32_t)udiv64(1000000ULL << CLOCK_SHIFT, tsc_khz, NULL);
+	tsc_base   = read_tsc();
+}
+
+uint64_t clock_now_ns(void)
+{
+	uint64_t cycles;
+	uint32_t high, low;
+
+	if (!tsc_khz)
+		return (uint64_t)timer_get_ticks() * TIMER_NS_PER_TICK;
+
+	cycles = read_tsc() - tsc_base;
+	high   = (uint32_t)(cycles >> 32);
+	low    = (uint32_t)cycles;
+
+	/* 64 x 32 bits product from two 32 x 32 bits ones, no libgcc */
+	return (((uint64_t)high * clock_mult) << (32 - CLOCK_SHIFT))
+		+ (((uint64_t)low * clock_mult) >> CLOCK_SHIFT);
+}
+
+uint32_t clock_get_tsc_khz(void)
+{
+	return tsc_khz;
+}
@@ -0,0 +1,26 @@
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+/**
+ * @file clock.h
+ * @license MIT License
+ *
+ * Monotonic clock with a nanosecond resolution.
+ *
+ * The time stamp counter is calibrated against the channel 2 of the PIT
+ * at boot, then read with rdtsc. Without a TSC the clock falls back on
+ * the timer ticks.
+ */
+
+#include <lib/types.h>
+
+/** Calibrate the TSC, before the interrupts are enabled */
+void clock_setup(void);
+
+/** Nanoseconds elapsed since clock_setup() */
+uint64_t clock_now_ns(void);
+
+/** Frequency of the TSC in kHz, 0 when there is none */
+uint32_t clock_get_tsc_khz(void);
+
+#endif // _CLOCK_H_
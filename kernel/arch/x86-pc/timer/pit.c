@@ -8,6 +8,7 @@
 
 
 #include <lib/status.h>
+#include <lib/libc.h>
 #include <arch/x86/io-ports.h>
 #include <arch/x86/interrupts/irq.h>
 #include <threading/scheduler.h>
@@ -23,6 +24,29 @@
 #define CHANNEL2  0x42	/* PC speaker */
 #define CONTROL_REGISTER 0x43
 
+/* Port B of the 8255: gate of channel 2, speaker, and channel 2 output */
+#define PORT_B         0x61
+#define PORT_B_GATE2   0x01
+#define PORT_B_SPEAKER 0x02
+#define PORT_B_OUT2    0x20
+
+/* Read-back command latching the status and the count of channel 0 */
+#define READ_BACK_CHANNEL0 0xC2
+/* Status bit: state of the OUT pin, high at the terminal count */
+#define STATUS_OUTPUT      0x80
+
+/* PIT clock periods per tick, and longest one-shot */
+#define TICK_COUNTS (MAX_FREQUENCY / TIMER_FREQUENCY)
+#define MAX_COUNTS  0xFFFF
+
+/* Ticks since the boot, up to the last expiry of the one-shot */
+static volatile uint32_t jiffies;
+
+/* Clock periods elapsed short of a whole tick */
+static uint32_t counts_remainder;
+
+/* Length of the armed one-shot, 0 once expired */
+static uint32_t programmed_counts;
 
 
 /**
@@ -68,25 +92,131 @@ ret_t x86_pit_set_frequency(uint32_t frequency)
 	return KERNEL_OK;
 }
 
+uint32_t x86_pit_channel2_start(uint32_t us)
+{
+	uint32_t counts = (MAX_FREQUENCY / 100) * us / 10000;
+	uint8_t port_b;
+
+	if (counts > MAX_COUNTS)
+		counts = MAX_COUNTS;
+
+	/* Gate high, speaker off */
+	port_b = inb(PORT_B);
+	outb(PORT_B, (port_b & ~PORT_B_SPEAKER) | PORT_B_GATE2);
+
+	/* Channel 2, LSB+MSB, interrupt on terminal count (mode 0): the
+	 * output goes high at the end instead of raising an IRQ */
+	outb(CONTROL_REGISTER, 0xB0);
+	outb(CHANNEL2, counts & 0xFF);
+	outb(CHANNEL2, (counts >> 8) & 0xFF);
+
+	return (uint32_t)udiv64((uint64_t)counts * 1000000000, MAX_FREQUENCY, NULL);
+}
+
+bool_t x86_pit_channel2_expired(void)
+{
+	return (inb(PORT_B) & PORT_B_OUT2) ? TRUE : FALSE;
+}
+
+/* Elapsed PIT clock periods: whole ticks go to jiffies */
+static void account_counts(uint32_t counts)
+{
+	counts_remainder += counts;
+	jiffies          += counts_remainder / TICK_COUNTS;
+	counts_remainder %= TICK_COUNTS;
+}
+
+/*
+ * Latch the status and the count of channel 0. Returns TRUE if the
+ * one-shot already reached its terminal count.
+ */
+static bool_t read_counter(uint16_t *remaining)
+{
+	uint8_t status, low, high;
+
+	outb(CONTROL_REGISTER, READ_BACK_CHANNEL0);
+
+	status = inb(CHANNEL0);
+	low    = inb(CHANNEL0);
+	high   = inb(CHANNEL0);
+
+	*remaining = (high << 8) | low;
+
+	return (status & STATUS_OUTPUT) ? TRUE : FALSE;
+}
+
+void timer_set_next_event(uint32_t ticks)
+{
+	uint32_t counts;
+	uint16_t remaining;
+
+	/* Still armed: account the time elapsed up to now. Once the terminal
+	 * count is reached the pending interrupt takes care of it. */
+	if (programmed_counts)
+	{
+		if (read_counter(&remaining))
+			return;
+
+		account_counts(programmed_counts - remaining);
+	}
+
+	/* Stay in phase with the tick boundaries */
+	if (ticks == TIMER_NO_EVENT || ticks > MAX_COUNTS / TICK_COUNTS)
+		counts = MAX_COUNTS;
+	else
+		counts = ticks * TICK_COUNTS - counts_remainder;
+
+	programmed_counts = counts;
+
+	/* Channel 0, LSB+MSB, interrupt on terminal count (mode 0) */
+	outb(CONTROL_REGISTER, 0x30);
+	outb(CHANNEL0, counts & 0xFF);
+	outb(CHANNEL0, (counts >> 8) & 0xFF);
+}
+
 void timer_interrupt_handler(int number)
 {
-    static int ticks = 0;
-    static int seconds = 0;
     uint32_t flags;
+    uint16_t remaining;
 
     (void)number; // Avoid a useless warning ;-)
 
-    ticks++;
+    /* Raised by the previous one-shot, which expired after
+     * timer_set_next_event() read it but before it was replaced: the
+     * time was accounted there and the new one-shot is still running */
+    if (programmed_counts && !read_counter(&remaining))
+        return;
 
-    if (ticks % 100 == 0)
-    {
-        seconds++;
-        ticks = 0;
-    }
+    /* The one-shot expired, the scheduler arms the next one */
+    account_counts(programmed_counts);
+    programmed_counts = 0;
 
     X86_IRQs_DISABLE(flags);
-    schedule();
+    scheduler_tick();
     X86_IRQs_ENABLE(flags);
 }
 
+uint32_t timer_get_ticks(void)
+{
+    uint32_t flags, ticks, elapsed;
+    uint16_t remaining;
 
+    X86_IRQs_DISABLE(flags);
+
+    ticks = jiffies;
+
+    /* Tickless: add the part of the armed one-shot already elapsed */
+    if (programmed_counts)
+    {
+        if (read_counter(&remaining))
+            elapsed = programmed_counts;
+        else
+            elapsed = programmed_counts - remaining;
+
+        ticks += (counts_remainder + elapsed) / TICK_COUNTS;
+    }
+
+    X86_IRQs_ENABLE(flags);
+
+    return ticks;
+}
@@ -16,6 +16,16 @@
 
 #include <lib/types.h>
 
+/** Frequency of the ticks, in Hz. The timer is tickless: it is
+ * programmed one-shot and only interrupts for the next event. */
+#define TIMER_FREQUENCY 1000
+
+/** Nanoseconds per tick */
+#define TIMER_NS_PER_TICK (1000000000UL / TIMER_FREQUENCY)
+
+/** No event planned: the one-shot is as long as the PIT allows */
+#define TIMER_NO_EVENT 0
+
 /** 
  * Changes timer interrupt frequency from the default one (18.222 Hz)
  * 
@@ -25,11 +35,34 @@
 ret_t x86_pit_set_frequency(uint32_t frequency);
 
 /**
-* Timer's interrupt handler called periodically
+ * Start a one-shot on channel 2, with the PC speaker kept silent. Other
+ * clocks are calibrated by polling x86_pit_channel2_expired().
+ *
+ * @param us Duration in microseconds, at most about 55 ms
+ * @return The exact duration programmed, in nanoseconds
+ */
+uint32_t x86_pit_channel2_start(uint32_t us);
+
+/** Whether the one-shot of channel 2 reached its terminal count */
+bool_t x86_pit_channel2_expired(void);
+
+/**
+ * Program the one-shot timer to interrupt in the given number of ticks,
+ * or TIMER_NO_EVENT. A one-shot armed before is cancelled. The PIT can't
+ * wait more than about 55 ms, longer delays expire early. IRQs must be
+ * disabled.
+ */
+void timer_set_next_event(uint32_t ticks);
+
+/**
+* Timer's interrupt handler called when the one-shot expires
 *
 * @param id
 */
 void timer_interrupt_handler(int number);
 
+/** Number of ticks since the boot. The PIT counter is read if armed. */
+uint32_t timer_get_ticks(void);
+
 #endif // _PIT_H_
 
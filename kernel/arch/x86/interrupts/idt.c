@@ -71,3 +71,28 @@ ret_t x86_idt_set_handler(uint32_t index,
 
 	return KERNEL_OK;
 }
+
+
+ret_t x86_idt_set_task_gate(uint32_t index,
+			      uint32_t tss_segment_index)
+{
+	struct x86_idt_entry *idt_entry;
+
+	if (index >= INTERRUPTIONS_MAX_LIMIT)
+		return -KERNEL_INVALID_VALUE;
+
+	idt_entry = global_idt + index;
+
+	/* The offset is unused, the task starts where its TSS says */
+	idt_entry->offset_low       = 0;
+	idt_entry->offset_high      = 0;
+	idt_entry->segment_selector =
+		X86_BUILD_SEGMENT_REGISTER_VALUE(tss_segment_index);
+
+	/* = 0x5 for task gate */
+	idt_entry->gate_type        = 0x5;
+	idt_entry->descriptor_privilidge_level = 0;
+	idt_entry->present          = 1;
+
+	return KERNEL_OK;
+}
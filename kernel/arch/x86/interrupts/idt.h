@@ -78,4 +78,13 @@ void x86_idt_setup(void);
 ret_t x86_idt_set_handler(uint32_t index,
 			      uint32_t handler_address);
 
+/**
+ * Handle an interruption in a task of its own, e.g. with its own stack
+ * @param index 		Index in IDT
+ * @param tss_segment_index	Index of the task's TSS descriptor in the GDT
+ * @return KERNEL_OK on success or KERNEL_INVALID_VALUE on failure
+ * */
+ret_t x86_idt_set_task_gate(uint32_t index,
+			      uint32_t tss_segment_index);
+
 #endif // _IDT_H_
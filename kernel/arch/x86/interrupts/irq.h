@@ -30,6 +30,9 @@
 #define IRQ_RESERVED_5    15
 
 
+/* Interrupt enable flag of EFLAGS */
+#define X86_EFLAGS_IF 0x00000200
+
 #define X86_IRQs_DISABLE(flags) \
 	({asm volatile("pushfl ; popl %0":"=g"(flags)::"memory"); asm("cli\n");})
 
@@ -91,3 +91,18 @@ ISR_NO_ERROR_CODE 28 ; Reserved
 ISR_NO_ERROR_CODE 29 ; Reserved
 ISR_NO_ERROR_CODE 30 ; Reserved
 ISR_NO_ERROR_CODE 31 ; Reserved
+
+
+; Page faults are handled in a task of their own, entered through a task
+; gate, so that a fault on an unmapped stack page doesn't need the faulting
+; stack. The error code is pushed on the task's stack and each fault
+; resumes the task right after its iret.
+
+[extern x86_paging_fault_handler]
+[global page_fault_task]
+
+page_fault_task:
+    call x86_paging_fault_handler	; The error code is its argument
+    add esp, 4		; Cleans up the pushed error code
+    iret		; Back to the faulting task, its instruction is restarted
+    jmp page_fault_task
@@ -10,11 +10,15 @@
 #include <arch/x86/mmu/segment.h>
 #include <lib/types.h>
 #include <lib/libc.h>
+#include <arch/x86/threading/fpu.h>
 
 #include "isr.h"
 
 #define EXCEPTIONS_NUMBER 32
 
+/* Device not available: an FPU instruction with CR0.TS set */
+#define EXCEPTION_NO_COPROCESSOR 7
+
 extern void isr0();
 extern void isr1();
 extern void isr2();
@@ -135,6 +139,13 @@ char *exception_messages[] =
 
 void x86_isr_handler(struct regs *r)
 {
+    // Lazy FPU switch, the faulting instruction runs again
+    if (r->interrupt_number == EXCEPTION_NO_COPROCESSOR)
+    {
+        x86_fpu_handle_unavailable();
+        return;
+    }
+
     if (r->interrupt_number < EXCEPTIONS_NUMBER)
     {
         printf(">> Exception: %s. System Halted! <<\n", exception_messages[r->interrupt_number]);
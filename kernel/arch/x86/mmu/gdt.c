@@ -76,10 +76,11 @@ struct x86_gdtr
   })
 
 
-static struct x86_gdt_entry gdt[] = {
+static struct x86_gdt_entry gdt[GDT_NB_SEGMENTS] = {
 	[NULL_SEGMENT]  = (struct x86_gdt_entry){ 0, },
 	[KERNEL_CODE_SEGMENT] = BUILD_GDT_ENTRY(1),
 	[KERNEL_DATA_SEGMENT] = BUILD_GDT_ENTRY(0)
+	/* The TSS descriptors are set with x86_gdt_set_tss() */
 };
 
 
@@ -114,5 +115,21 @@ void x86_gdt_setup(void)
 		:"memory","eax");
 }
 
-
-
+void x86_gdt_set_tss(uint32_t segment_index, uint32_t base_address,
+		uint32_t size)
+{
+	gdt[segment_index] = (struct x86_gdt_entry) {
+		.segment_limit_15_0         = (size - 1) & 0xffff,
+		.base_paged_address_15_0    = base_address & 0xffff,
+		.base_paged_address_23_16   = (base_address >> 16) & 0xff,
+		.segment_type               = 0x9, /* Available 32 bits TSS */
+		.descriptor_type            = 0,   /* 0=System */
+		.descriptor_privilege_level = 0,
+		.segment_present            = 1,
+		.segment_limit_19_16        = ((size - 1) >> 16) & 0xf,
+		.available                  = 0,
+		.operand_size               = 0,
+		.granularity                = 0,   /* limit is in bytes */
+		.base_paged_address_31_24   = (base_address >> 24) & 0xff
+	};
+}
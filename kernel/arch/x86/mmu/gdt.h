@@ -17,5 +17,15 @@
 /** Setup GDT by initializing the GDTR register */
 void x86_gdt_setup(void);
 
+/**
+ * Register a task state segment in the GDT
+ *
+ * @param segment_index Index of the TSS descriptor, @see segment.h
+ * @param base_address Address of the TSS
+ * @param size Size of the TSS
+ */
+void x86_gdt_set_tss(uint32_t segment_index, uint32_t base_address,
+		uint32_t size);
+
 
 #endif // _GDT_H_
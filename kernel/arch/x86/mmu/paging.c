@@ -0,0 +1,258 @@
+/**
+ * @license MIT License
+ *
+ * Paging setup
+ */
+
+#include <lib/libc.h>
+#include <memory/physical-memory.h>
+#include <arch/x86/interrupts/idt.h>
+
+#include "segment.h"
+#include "tss.h"
+#include "paging.h"
+
+#define ENTRIES_PER_TABLE 1024
+
+#define DIRECTORY_INDEX(vaddr)	((uint32_t)(vaddr) >> 22)
+#define TABLE_INDEX(vaddr)	(((uint32_t)(vaddr) >> 12) & 0x3ff)
+
+/* Address bits of the entries */
+#define TABLE_ADDRESS_MASK	0xfffff000
+#define LARGE_ADDRESS_MASK	0xffc00000
+
+/* Flags kept when a 4 MiB page is split: P, RW, US, PWT, PCD and G */
+#define SPLIT_FLAGS_MASK	0x11f
+
+/* Control registers' bits */
+#define CR0_WP			0x00010000
+#define CR0_PG			0x80000000
+#define CR4_PSE			0x00000010
+#define CR4_PGE			0x00000080
+
+/* CPUID leaf 1 features */
+#define CPUID_PSE		0x00000008
+#define CPUID_PGE		0x00002000
+
+/* Page fault exception */
+#define PAGE_FAULT		14
+
+/* Entry point of the page fault task */
+extern void page_fault_task(void);
+
+static uint32_t page_directory[ENTRIES_PER_TABLE]
+	__attribute__((aligned(X86_PAGE_SIZE)));
+
+static bool_t large_pages;
+static uint32_t global_flag;
+
+static struct x86_tss page_fault_tss;
+static uint8_t page_fault_stack[X86_PAGE_SIZE]
+	__attribute__((aligned(16)));
+static x86_paging_fault_handler_t fault_handler;
+
+
+static uint32_t cpuid_features(void)
+{
+	uint32_t eax = 1, ebx, ecx, edx;
+
+	asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+	return edx;
+}
+
+static inline void invalidate_page(vaddr_t vaddr)
+{
+	asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
+}
+
+/* Flush the whole TLB, global entries included */
+static void invalidate_all(void)
+{
+	uint32_t cr4;
+
+	asm volatile("movl %%cr4, %0" : "=r"(cr4));
+	asm volatile("movl %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+	asm volatile("movl %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
+/* Page table covering an address, a 4 MiB page being split into one */
+static uint32_t *get_page_table(vaddr_t vaddr)
+{
+	uint32_t *pde = &page_directory[DIRECTORY_INDEX(vaddr)];
+	uint32_t *table;
+	uint32_t i;
+
+	if ((*pde & X86_PAGING_PRESENT) && !(*pde & X86_PAGING_LARGE))
+		return (uint32_t *)(*pde & TABLE_ADDRESS_MASK);
+
+	table = physical_memory_page_reference_new();
+
+	if (!table)
+		return NULL;
+
+	// The 4 KiB pages map the same memory as the 4 MiB page, so that
+	// stale TLB entries are harmless until the flush
+	for (i = 0; i < ENTRIES_PER_TABLE; i++)
+	{
+		if (*pde & X86_PAGING_PRESENT)
+			table[i] = ((*pde & LARGE_ADDRESS_MASK) + (i << X86_PAGE_SHIFT))
+				| (*pde & SPLIT_FLAGS_MASK);
+		else
+			table[i] = 0;
+	}
+
+	// Access rights are checked on the page table entries
+	*pde = (uint32_t)table | X86_PAGING_PRESENT | X86_PAGING_WRITABLE
+		| X86_PAGING_USER;
+
+	invalidate_all();
+
+	return table;
+}
+
+
+void x86_paging_setup(paddr_t ram_end)
+{
+	uint32_t features = cpuid_features();
+	uint32_t nb_large_pages, i;
+	uint32_t cr0, cr4;
+
+	large_pages = (features & CPUID_PSE) ? TRUE : FALSE;
+	global_flag = (features & CPUID_PGE) ? X86_PAGING_GLOBAL : 0;
+
+	nb_large_pages = (ram_end + X86_PAGING_LARGE_SIZE - 1) / X86_PAGING_LARGE_SIZE;
+
+	memset(page_directory, 0, sizeof(page_directory));
+
+	// Identity mapping of the kernel and the RAM
+	for (i = 0; i < nb_large_pages; i++)
+	{
+		paddr_t address = i * X86_PAGING_LARGE_SIZE;
+		uint32_t j;
+
+		if (large_pages)
+		{
+			x86_paging_map_large(address, address,
+				X86_PAGING_WRITABLE | global_flag);
+			continue;
+		}
+
+		// Without PSE, the RAM is mapped with 4 KiB pages
+		for (j = 0; j < ENTRIES_PER_TABLE; j++)
+		{
+			if (x86_paging_map(address + (j << X86_PAGE_SHIFT),
+					address + (j << X86_PAGE_SHIFT),
+					X86_PAGING_WRITABLE | global_flag) != KERNEL_OK)
+				panic("No memory for the page tables");
+		}
+	}
+
+	// NULL pointers dereferences will raise a page fault
+	if (x86_paging_unmap(0) != KERNEL_OK)
+		panic("No memory for the page tables");
+
+	// The CPU loads CR3 from the TSS on task switches
+	x86_tss_set_page_directory((paddr_t)page_directory);
+	x86_tss_setup_task(PAGE_FAULT_TSS_SEGMENT, &page_fault_tss,
+		page_fault_task,
+		(uint32_t)page_fault_stack + sizeof(page_fault_stack),
+		(paddr_t)page_directory);
+	x86_idt_set_task_gate(PAGE_FAULT, PAGE_FAULT_TSS_SEGMENT);
+
+	asm volatile("movl %0, %%cr3" :: "r"(page_directory) : "memory");
+
+	asm volatile("movl %%cr4, %0" : "=r"(cr4));
+	cr4 |= (large_pages ? CR4_PSE : 0) | (global_flag ? CR4_PGE : 0);
+	asm volatile("movl %0, %%cr4" :: "r"(cr4) : "memory");
+
+	// The kernel can't write to read-only pages either
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	asm volatile("movl %0, %%cr0" :: "r"(cr0 | CR0_PG | CR0_WP) : "memory");
+}
+
+ret_t x86_paging_map(vaddr_t vaddr, paddr_t paddr, uint32_t flags)
+{
+	uint32_t *table = get_page_table(vaddr);
+
+	if (!table)
+		return -KERNEL_NO_MEMORY;
+
+	table[TABLE_INDEX(vaddr)] = (paddr & TABLE_ADDRESS_MASK)
+		| (flags & ~X86_PAGING_LARGE) | X86_PAGING_PRESENT;
+	invalidate_page(vaddr);
+
+	return KERNEL_OK;
+}
+
+ret_t x86_paging_unmap(vaddr_t vaddr)
+{
+	uint32_t *table = get_page_table(vaddr);
+
+	if (!table)
+		return -KERNEL_NO_MEMORY;
+
+	table[TABLE_INDEX(vaddr)] = 0;
+	invalidate_page(vaddr);
+
+	return KERNEL_OK;
+}
+
+ret_t x86_paging_map_large(vaddr_t vaddr, paddr_t paddr, uint32_t flags)
+{
+	uint32_t *pde = &page_directory[DIRECTORY_INDEX(vaddr)];
+	uint32_t old_pde = *pde;
+
+	if (!large_pages
+		|| vaddr % X86_PAGING_LARGE_SIZE
+		|| paddr % X86_PAGING_LARGE_SIZE)
+		return -KERNEL_INVALID_VALUE;
+
+	*pde = paddr | flags | X86_PAGING_LARGE | X86_PAGING_PRESENT;
+	invalidate_all();
+
+	if ((old_pde & X86_PAGING_PRESENT) && !(old_pde & X86_PAGING_LARGE))
+		physical_memory_page_unreference(old_pde & TABLE_ADDRESS_MASK);
+
+	return KERNEL_OK;
+}
+
+paddr_t x86_paging_get_physical(vaddr_t vaddr)
+{
+	uint32_t pde = page_directory[DIRECTORY_INDEX(vaddr)];
+	uint32_t pte;
+
+	if (!(pde & X86_PAGING_PRESENT))
+		return 0;
+
+	if (pde & X86_PAGING_LARGE)
+		return (pde & LARGE_ADDRESS_MASK) | (vaddr & ~LARGE_ADDRESS_MASK);
+
+	pte = ((uint32_t *)(pde & TABLE_ADDRESS_MASK))[TABLE_INDEX(vaddr)];
+
+	if (!(pte & X86_PAGING_PRESENT))
+		return 0;
+
+	return (pte & TABLE_ADDRESS_MASK) | (vaddr & X86_PAGE_MASK);
+}
+
+void x86_paging_set_fault_handler(x86_paging_fault_handler_t handler)
+{
+	fault_handler = handler;
+}
+
+void x86_paging_fault_handler(uint32_t error_code)
+{
+	vaddr_t address;
+
+	asm volatile("movl %%cr2, %0" : "=r"(address));
+
+	if (fault_handler && fault_handler(address, error_code,
+			x86_tss_get_kernel_esp(),
+			x86_tss_get_kernel_eflags()) == KERNEL_OK)
+		return;
+
+	printf(">> Exception: Page Fault at %x (error %x). System Halted! <<\n",
+		address, error_code);
+	for (;;);
+}
@@ -0,0 +1,91 @@
+#ifndef _PAGING_H_
+#define _PAGING_H_
+
+/**
+ * @file paging.h
+ * @license MIT License
+ * @see IA-32 Intel Architecture Software Developer's Manual, Volume 3 [Chapter 4]
+ *
+ * Paging setup. The RAM is identity mapped, so that virtual address ==
+ * physical address as before, with 4 MiB pages (PSE) to keep the TLB
+ * pressure minimal. A 4 MiB page is split into a page table of 4 KiB
+ * pages when a region needs a finer control, e.g. the first page which
+ * is left unmapped to catch NULL pointers.
+ */
+
+#include <lib/types.h>
+#include <lib/status.h>
+
+/** Page directory and page table entries' flags */
+#define X86_PAGING_PRESENT   0x001
+#define X86_PAGING_WRITABLE  0x002
+#define X86_PAGING_USER      0x004
+#define X86_PAGING_LARGE     0x080	/**< 4 MiB page, directory only */
+#define X86_PAGING_GLOBAL    0x100
+
+/** Memory covered by a page directory entry */
+#define X86_PAGING_LARGE_SIZE (4*1024*1024)
+
+/**
+ * Page fault handler, the faulting instruction is restarted when it
+ * returns KERNEL_OK
+ *
+ * @param address The faulting address
+ * @param error_code The page fault error code pushed by the CPU
+ * @param stack_pointer ESP of the faulting code
+ * @param eflags EFLAGS of the faulting code
+ */
+typedef ret_t (*x86_paging_fault_handler_t)(vaddr_t address,
+		uint32_t error_code, vaddr_t stack_pointer, uint32_t eflags);
+
+/**
+ * Identity map the RAM and enable paging. Page faults are handled in a
+ * task of their own, with its own stack, so that they can be recovered
+ * from even when the faulting stack isn't mapped
+ *
+ * @param ram_end End of the RAM, rounded up to a 4 MiB boundary
+ */
+void x86_paging_setup(paddr_t ram_end);
+
+/**
+ * Map a 4 KiB page, splitting the 4 MiB page covering it if needed
+ *
+ * @param vaddr Virtual address of the page
+ * @param paddr Physical address of the page
+ * @param flags X86_PAGING_* flags, X86_PAGING_PRESENT is implied
+ * @return KERNEL_OK or -KERNEL_NO_MEMORY if no page table can be allocated
+ */
+ret_t x86_paging_map(vaddr_t vaddr, paddr_t paddr, uint32_t flags);
+
+/**
+ * Unmap a 4 KiB page, splitting the 4 MiB page covering it if needed
+ *
+ * @return KERNEL_OK or -KERNEL_NO_MEMORY if no page table can be allocated
+ */
+ret_t x86_paging_unmap(vaddr_t vaddr);
+
+/**
+ * Map a 4 MiB page, the page table previously covering it is released
+ *
+ * @param vaddr Virtual address, aligned on 4 MiB
+ * @param paddr Physical address, aligned on 4 MiB
+ * @param flags X86_PAGING_* flags, X86_PAGING_PRESENT is implied
+ * @return KERNEL_OK or -KERNEL_INVALID_VALUE if the addresses are not
+ * aligned or 4 MiB pages are not supported
+ */
+ret_t x86_paging_map_large(vaddr_t vaddr, paddr_t paddr, uint32_t flags);
+
+/**
+ * Translate a virtual address
+ *
+ * @return The physical address or 0 if the address is not mapped
+ */
+paddr_t x86_paging_get_physical(vaddr_t vaddr);
+
+/** Set the handler of the page faults, which halt the system otherwise */
+void x86_paging_set_fault_handler(x86_paging_fault_handler_t handler);
+
+/** Called by the page fault task */
+void x86_paging_fault_handler(uint32_t error_code);
+
+#endif // _PAGING_H_
@@ -14,6 +14,12 @@
 #define NULL_SEGMENT        0
 #define KERNEL_CODE_SEGMENT 1
 #define KERNEL_DATA_SEGMENT 2
+/** Task state segments */
+#define KERNEL_TSS_SEGMENT     3
+#define PAGE_FAULT_TSS_SEGMENT 4
+
+/** Number of GDT entries */
+#define GDT_NB_SEGMENTS        5
 
 /**
  * Builds a value for a segment register
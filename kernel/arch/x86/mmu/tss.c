@@ -0,0 +1,70 @@
+/**
+ * @license MIT License
+ *
+ * Task state segments
+ */
+
+#include <lib/libc.h>
+
+#include "gdt.h"
+#include "segment.h"
+#include "tss.h"
+
+/* Only bit 1 is set, interrupts are disabled */
+#define EFLAGS_DEFAULT 0x2
+
+static struct x86_tss kernel_tss;
+
+
+void x86_tss_setup(void)
+{
+	memset(&kernel_tss, 0, sizeof(kernel_tss));
+	kernel_tss.io_map_base = sizeof(kernel_tss);
+
+	x86_gdt_set_tss(KERNEL_TSS_SEGMENT, (uint32_t)&kernel_tss,
+		sizeof(kernel_tss));
+
+	asm volatile("ltr %w0"
+		:: "r"(X86_BUILD_SEGMENT_REGISTER_VALUE(KERNEL_TSS_SEGMENT)));
+}
+
+void x86_tss_set_page_directory(paddr_t page_directory)
+{
+	kernel_tss.cr3 = page_directory;
+}
+
+uint32_t x86_tss_get_kernel_esp(void)
+{
+	return kernel_tss.esp;
+}
+
+uint32_t x86_tss_get_kernel_eflags(void)
+{
+	return kernel_tss.eflags;
+}
+
+void x86_tss_setup_task(uint32_t segment_index,
+		struct x86_tss *tss,
+		void (*entry)(void),
+		uint32_t stack_top,
+		paddr_t page_directory)
+{
+	uint16_t data_segment =
+		X86_BUILD_SEGMENT_REGISTER_VALUE(KERNEL_DATA_SEGMENT);
+
+	memset(tss, 0, sizeof(struct x86_tss));
+
+	tss->cr3    = page_directory;
+	tss->eip    = (uint32_t)entry;
+	tss->eflags = EFLAGS_DEFAULT;
+	tss->esp    = stack_top;
+	tss->cs     = X86_BUILD_SEGMENT_REGISTER_VALUE(KERNEL_CODE_SEGMENT);
+	tss->ss     = data_segment;
+	tss->ds     = data_segment;
+	tss->es     = data_segment;
+	tss->fs     = data_segment;
+	tss->gs     = data_segment;
+	tss->io_map_base = sizeof(struct x86_tss);
+
+	x86_gdt_set_tss(segment_index, (uint32_t)tss, sizeof(struct x86_tss));
+}
@@ -0,0 +1,72 @@
+#ifndef _TSS_H_
+#define _TSS_H_
+
+/**
+ * @file tss.h
+ * @license MIT License
+ * @see IA-32 Intel Architecture Software Developer's Manual, Volume 3 [Chapter 7]
+ *
+ * Task state segments. The kernel threads are switched by software, in a
+ * single hardware task whose TSS only receives the CPU state when an
+ * exception is handled by a task of its own through a task gate.
+ */
+
+#include <lib/types.h>
+
+/** A 32 bits task state segment, without I/O permission bitmap */
+struct x86_tss
+{
+	uint16_t back_link, reserved0;
+	uint32_t esp0;
+	uint16_t ss0, reserved1;
+	uint32_t esp1;
+	uint16_t ss1, reserved2;
+	uint32_t esp2;
+	uint16_t ss2, reserved3;
+	uint32_t cr3;
+	uint32_t eip, eflags;
+	uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+	uint16_t es, reserved4;
+	uint16_t cs, reserved5;
+	uint16_t ss, reserved6;
+	uint16_t ds, reserved7;
+	uint16_t fs, reserved8;
+	uint16_t gs, reserved9;
+	uint16_t ldt, reserved10;
+	uint16_t trap, io_map_base;
+} __attribute__((packed));
+
+/** Load the task register with the kernel's TSS */
+void x86_tss_setup(void);
+
+/**
+ * Set the page directory loaded when switching back to the kernel's task
+ * (the CPU doesn't save CR3 on task switches)
+ */
+void x86_tss_set_page_directory(paddr_t page_directory);
+
+/**
+ * Stack pointer of the kernel's task, saved when it was switched out to
+ * an exception task: that of the code which raised the exception
+ */
+uint32_t x86_tss_get_kernel_esp(void);
+
+/** EFLAGS of the kernel's task, saved along with its stack pointer */
+uint32_t x86_tss_get_kernel_eflags(void);
+
+/**
+ * Setup a task entered through a task gate, with interrupts disabled
+ *
+ * @param segment_index Index of its TSS descriptor, @see segment.h
+ * @param tss Its TSS
+ * @param entry Code executed by the task
+ * @param stack_top Top of the task's stack
+ * @param page_directory Page directory of the task
+ */
+void x86_tss_setup_task(uint32_t segment_index,
+		struct x86_tss *tss,
+		void (*entry)(void),
+		uint32_t stack_top,
+		paddr_t page_directory);
+
+#endif // _TSS_H_
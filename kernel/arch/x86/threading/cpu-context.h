@@ -12,12 +12,23 @@ struct cpu_state;
  */
 typedef void (cpu_kstate_function_arg1_t(uint32_t arg1));
 
+/*
+ * Setup the context of a new kernel thread: it calls start_func, then
+ * exit_func once start_func returns. exit_func must not return.
+ */
 void cpu_kstate_init(struct cpu_state **kctxt,
 		cpu_kstate_function_arg1_t *start_func,
 		uint32_t start_arg,
 		uint32_t stack_base,
-		uint32_t stack_size);
+		uint32_t stack_size,
+		cpu_kstate_function_arg1_t *exit_func,
+		uint32_t exit_arg);
 
+/*
+ * Save the context of the current thread in from_ctxt and resume the one
+ * of to_ctxt. Must be called with IRQs disabled: only the callee-saved
+ * registers are switched, not EFLAGS.
+ */
 void cpu_context_switch(struct cpu_state **from_ctxt,
 		struct cpu_state *to_ctxt);
 
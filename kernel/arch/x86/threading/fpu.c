@@ -0,0 +1,178 @@
+#include <lib/libc.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "fpu.h"
+
+#define CR0_MP 0x00000002	/* WAIT honors TS */
+#define CR0_EM 0x00000004	/* Emulation, no FPU */
+#define CR0_TS 0x00000008	/* Task switched: FPU instructions fault */
+#define CR0_NE 0x00000020	/* Native FPU errors, #MF instead of IRQ 13 */
+
+#define CR4_OSFXSR     0x00000200
+#define CR4_OSXMMEXCPT 0x00000400
+
+#define CPUID_FEATURE_FXSR 0x01000000
+#define CPUID_FEATURE_SSE  0x02000000
+
+/* All the SIMD floating point exceptions masked, the reset value */
+#define MXCSR_DEFAULT 0x1F80
+
+static bool_t has_fxsr;
+static bool_t has_sse;
+
+/* State of the running thread, and of the thread whose registers are in
+ * the FPU, if any */
+static struct x86_fpu_state *current_state;
+static struct x86_fpu_state *owner;
+
+/* Mirrors CR0.TS, so that CR0 is only written when it changes. The
+ * hardware task switches to and from the page fault task set CR0.TS
+ * behind its back: it may be set while the mirror says it is clear. */
+static bool_t ts_set;
+
+static uint32_t nb_faults;
+
+static inline uint32_t read_cr0(void)
+{
+	uint32_t cr0;
+
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0)
+{
+	asm volatile("movl %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+static inline void set_ts(void)
+{
+	if (!ts_set)
+	{
+		write_cr0(read_cr0() | CR0_TS);
+		ts_set = TRUE;
+	}
+}
+
+static inline void clear_ts(void)
+{
+	if (ts_set)
+	{
+		asm volatile("clts");
+		ts_set = FALSE;
+	}
+}
+
+static void save(struct x86_fpu_state *state)
+{
+	if (has_fxsr)
+		asm volatile("fxsave %0" : "=m"(state->area));
+	else
+		asm volatile("fnsave %0" : "=m"(state->area));
+}
+
+static void restore(struct x86_fpu_state *state)
+{
+	if (has_fxsr)
+		asm volatile("fxrstor %0" :: "m"(state->area));
+	else
+		asm volatile("frstor %0" :: "m"(state->area));
+}
+
+void x86_fpu_setup(void)
+{
+	uint32_t eax = 1, ebx, ecx, edx, cr4, mxcsr = MXCSR_DEFAULT;
+
+	asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+	has_fxsr = (edx & CPUID_FEATURE_FXSR) != 0;
+	has_sse  = has_fxsr && (edx & CPUID_FEATURE_SSE);
+
+	write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+	ts_set = FALSE;
+
+	if (has_fxsr)
+	{
+		asm volatile("movl %%cr4, %0" : "=r"(cr4));
+		cr4 |= CR4_OSFXSR;
+
+		if (has_sse)
+			cr4 |= CR4_OSXMMEXCPT;
+
+		asm volatile("movl %0, %%cr4" :: "r"(cr4));
+	}
+
+	asm volatile("fninit");
+
+	if (has_sse)
+		asm volatile("ldmxcsr %0" :: "m"(mxcsr));
+
+	/* Nobody owns the registers yet, the first user faults */
+	owner = NULL;
+	set_ts();
+}
+
+void x86_fpu_init(struct x86_fpu_state *state)
+{
+	state->used = FALSE;
+}
+
+void x86_fpu_switch(struct x86_fpu_state *next)
+{
+	current_state = next;
+
+	/* Back to the owner: its registers are still there */
+	if (next == owner)
+		clear_ts();
+	else
+		set_ts();
+}
+
+void x86_fpu_release(struct x86_fpu_state *state)
+{
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	if (owner == state)
+		owner = NULL;
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void x86_fpu_handle_unavailable(void)
+{
+	uint32_t mxcsr = MXCSR_DEFAULT;
+
+	/* Whatever the mirror says, after a page fault the owner faults too */
+	asm volatile("clts");
+	ts_set = FALSE;
+
+	if (!current_state || owner == current_state)
+		return;
+
+	nb_faults++;
+
+	if (owner)
+		save(owner);
+
+	if (current_state->used)
+		restore(current_state);
+	else
+	{
+		/* First use: clean registers */
+		asm volatile("fninit");
+
+		if (has_sse)
+			asm volatile("ldmxcsr %0" :: "m"(mxcsr));
+
+		current_state->used = TRUE;
+	}
+
+	owner = current_state;
+}
+
+uint32_t x86_fpu_get_nb_faults(void)
+{
+	return nb_faults;
+}
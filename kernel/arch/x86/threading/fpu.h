@@ -0,0 +1,53 @@
+#ifndef _FPU_H_
+#define _FPU_H_
+
+/**
+ * @file fpu.h
+ * @license MIT License
+ *
+ * Lazy switch of the x87 FPU and SSE registers between the threads.
+ *
+ * The registers stay in the CPU until another thread uses them: switching
+ * threads only sets CR0.TS, and the first FPU or SSE instruction of the
+ * next thread raises the "device not available" exception (#NM), whose
+ * handler saves the registers of their previous owner and restores the
+ * ones of the current thread. A thread which never touches the FPU thus
+ * never pays for a save nor a restore. Interrupt handlers must not use
+ * the FPU.
+ */
+
+#include <lib/types.h>
+
+/** FXSAVE image, or FNSAVE's on the CPUs without FXSR */
+struct x86_fpu_state
+{
+	uint8_t area[512];
+
+	/* Never used yet: initialized by the first #NM */
+	bool_t used;
+} __attribute__((aligned(16)));
+
+/** Enable the FPU and SSE, and the lazy switch. Threads start unused. */
+void x86_fpu_setup(void);
+
+/** Initialize the state of a new thread */
+void x86_fpu_init(struct x86_fpu_state *state);
+
+/**
+ * Called on every context switch, IRQs disabled: the registers are only
+ * switched once the next thread uses them
+ *
+ * @param next The state of the thread about to run
+ */
+void x86_fpu_switch(struct x86_fpu_state *next);
+
+/** Forget a state about to be freed, the registers may still hold it */
+void x86_fpu_release(struct x86_fpu_state *state);
+
+/** The #NM handler: load the registers of the current thread */
+void x86_fpu_handle_unavailable(void);
+
+/** Number of lazy switches of the registers done by the #NM handler */
+uint32_t x86_fpu_get_nb_faults(void);
+
+#endif // _FPU_H_
@@ -1,5 +1,8 @@
 #include <arch/x86-pc/io/vga.h>
 #include <lib/libc.h>
+#include <memory/physical-memory.h>
+#include <arch/x86-pc/timer/clock.h>
+#include <threading/thread.h>
 
 #include "colorforth.h"
 
@@ -138,6 +141,35 @@ void dot(void)
 	printf("%d ", (int)stack_pop());
 }
 
+/* Dump the heap usage counters and push the bytes in use */
+void heap(void)
+{
+	struct heap_statistics stats;
+
+	heap_get_statistics(&stats);
+
+	vga_set_position(0, 14);
+	vga_set_attributes(FG_CYAN | BG_BLACK);
+	heap_dump_statistics();
+
+	stack_push(stats.bytes_in_use);
+}
+
+/* Push the low 32 bits of the monotonic clock, in nanoseconds: the
+ * difference of two readings times code up to about 4 seconds */
+void ns(void)
+{
+	stack_push((cell_t)clock_now_ns());
+}
+
+/* Dump the scheduling statistics of the threads */
+void sched(void)
+{
+	vga_set_position(0, 14);
+	vga_set_attributes(FG_CYAN | BG_BLACK);
+	thread_dump_statistics();
+}
+
 /*
  * Helper functions
  */
@@ -170,6 +202,9 @@ word_t forth_dictionary[128] =
 	{.name = 0xea000000, .code_address = dot},
 	{.name = 0xf6000000, .code_address = add},
 	{.name = 0xee000000, .code_address = divide},
+	{.name = 0xc88b8800, .code_address = heap},
+	{.name = 0x68000000, .code_address = ns},
+	{.name = 0x84b22600, .code_address = sched},
 	{0, 0},
 };
 
@@ -71,18 +71,18 @@ do_cmd(char *word)
 }
 
 static void
-handle_input(uchar_t scancode)
+handle_input(uchar_t key)
 {
 	static bool_t escape = FALSE;
 	static uint8_t i = 0;
 	static char word[32];
 
-	if (scancode == KEY_ESCAPE)
+	if (key == KBD_ESCAPE)
 	{
 		escape = TRUE;
 		return;
 	}
-	else if (scancode == KEY_F1)
+	else if (key == KBD_F1)
 	{
 		if (is_hex)
 			is_hex = FALSE;
@@ -92,7 +92,7 @@ handle_input(uchar_t scancode)
 		dot_s();
 		return;
 	}
-	else if (scancode == KEY_F2)
+	else if (key == KBD_F2)
 	{
 		is_command = TRUE;
 		command_prompt();
@@ -103,7 +103,7 @@ handle_input(uchar_t scancode)
 	{
 		escape = FALSE;
 
-		switch(keyboard_get_keymap(scancode))
+		switch(key)
 		{
 			case 'r':
 				vga_set_attributes(FG_RED | BG_BLACK);
@@ -140,10 +140,10 @@ handle_input(uchar_t scancode)
 		}
 	}
 
-	switch(scancode)
+	switch(key)
 	{
 
-		case KEY_SPACE:
+		case ' ':
 			word[i] = '\0';
 			i = 0;
 
@@ -153,34 +153,34 @@ handle_input(uchar_t scancode)
 				vga_display_character(' ');
 			break;
 
-		case KEY_UP:
+		case KBD_UP:
 			vga_update_position(0, -1);
 			vga_update_cursor();
 			break;
 
-		case KEY_DOWN:
+		case KBD_DOWN:
 			vga_update_position(0, 1);
 			vga_update_cursor();
 			break;
 
-		case KEY_LEFT:
+		case KBD_LEFT:
 			vga_update_position(-1, 0);
 			vga_update_cursor();
 			break;
 
-		case KEY_RIGHT:
+		case KBD_RIGHT:
 			vga_update_position(1, 0);
 			vga_update_cursor();
 			break;
 
-		case KEY_PAGE_UP:
+		case KBD_PAGE_UP:
 			if (nb_block-1 == -1)
 				break;
 
 			display_block(--nb_block);
 			break;
 
-		case KEY_PAGE_DOWN:
+		case KBD_PAGE_DOWN:
 			if (nb_block+1 > (cell_t)total_blocks-1)
 				break;
 
@@ -188,10 +188,15 @@ handle_input(uchar_t scancode)
 			break;
 
 		default:
-			vga_display_character(keyboard_get_keymap(scancode));
+			// Other special keys are not handled yet
+			if (key >= 0x80)
+				break;
+
+			vga_display_character(key);
 
 			// Make a word from characters (it won't be patented ;-)
-			word[i++] = keyboard_get_keymap(scancode);
+			if (i < sizeof(word) - 1)
+				word[i++] = key;
 	}
 }
 
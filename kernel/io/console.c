@@ -1,48 +1,57 @@
 #include <arch/x86-pc/io/vga.h>
-#include <arch/x86-pc/io/keyboard.h>
 #include <lib/status.h>
 #include <lib/libc.h>
 #include <lib/queue.h>
+#include <lib/ring.h>
+#include <arch/x86/interrupts/irq.h>
+#include <threading/wait-queue.h>
+#include <threading/mutex.h>
 
 #include "console.h"
 
-#define CONSOLE_BUFFER_LENGTH 64
+#if (CONSOLE_BUFFER_LENGTH & (CONSOLE_BUFFER_LENGTH - 1)) != 0
+#error "CONSOLE_BUFFER_LENGTH must be a power of 2"
+#endif
 
 struct console
 {
-	char	buffer[CONSOLE_BUFFER_LENGTH];
-	uint8_t buffer_read;
-	uint8_t buffer_write;
+	/* Input written by an interrupt handler, read by a thread */
+	uchar_t	buffer[CONSOLE_BUFFER_LENGTH];
+	struct ring input;
 	uint8_t mode;
 	void	(*write)(uchar_t c);
 
+	/* Threads waiting for a character to be available */
+	struct wait_queue readers;
+
+	/* The ring has a single consumer: one reader at a time, until its
+	 * line is complete */
+	struct mutex read_lock;
+
 	TAILQ_ENTRY(console) next;
 };
 
-TAILQ_HEAD(, console) consoles_list;
+TAILQ_HEAD(, console) consoles_list = TAILQ_HEAD_INITIALIZER(consoles_list);
 
 ret_t console_setup(struct console **terminal_out,
 		void (*write_function)(uchar_t c))
 {
 	struct console *terminal;
 
-	TAILQ_INIT(&consoles_list);
-
 	terminal = malloc(sizeof(struct console));
 
 	if (!terminal)
 		return -KERNEL_NO_MEMORY;
 
 	memset(terminal->buffer, 0, sizeof(terminal->buffer));
+	ring_init(&terminal->input, terminal->buffer, CONSOLE_BUFFER_LENGTH);
 	terminal->write        = write_function;
-	terminal->buffer_read  = 0;
-	terminal->buffer_write = 0;
 	terminal->mode         = CONSOLE_MODE_CANON;
+	wait_queue_init(&terminal->readers);
+	mutex_init(&terminal->read_lock, MUTEX_PRIORITY_INHERITANCE);
 
 	TAILQ_INSERT_TAIL(&consoles_list, terminal, next);
 
-	keyboard_setup(terminal);
-
 	*terminal_out = terminal;
 
 	return KERNEL_OK;
@@ -54,49 +63,67 @@ ret_t console_read(struct console *t,
 		size_t len)
 {
 	size_t count = 0;
+	int delimiter;
 
 	if (len == 0)
 		return KERNEL_OK;
 
+	delimiter = (t->mode & CONSOLE_MODE_CANON) ? '\n' : -1;
+
+	mutex_lock(&t->read_lock);
+
 	while (1)
 	{
-		char c;
+		size_t i, n;
 
 		/* No character available,  Wait until console_add_character()
 		 * wakes us up */
-		if (t->buffer_read == t->buffer_write)
+		wait_event(&t->readers, !ring_is_empty(&t->input));
+
+		/* Copy all the received characters at once from the ring
+		 * buffer to the destination buffer */
+		n = ring_get(&t->input, dst_buffer, len - count, delimiter);
+
+		if (t->mode & CONSOLE_MODE_ECHO)
 		{
-			/* Loop, maybe the semaphore was stolen by someone else */
-			continue;
+			for (i = 0; i < n; i++)
+				t->write(dst_buffer[i]);
 		}
 
-		c = t->buffer[t->buffer_read];
+		dst_buffer += n;
+		count      += n;
+
+		/* Did we read enough bytes ? */
+		if (count == len || (delimiter >= 0 && dst_buffer[-1] == delimiter))
+			break;
+	}
+
+	mutex_unlock(&t->read_lock);
 
-		/* Copy the received character from the ring buffer to the
-		 * destination buffer */
-		memcpy((void *)dst_buffer,
-				(void *)&t->buffer[t->buffer_read],
-				sizeof(char));
+	return KERNEL_OK;
+}
 
-		dst_buffer++;
 
-		/* Update the ring buffer read pointer */
-		t->buffer_read++;
+size_t console_dequeue(struct console *t, uchar_t *dst_buffer, size_t len)
+{
+	size_t n;
 
-		if (t->buffer_read == CONSOLE_BUFFER_LENGTH)
-			t->buffer_read = 0;
+	/* Still the single consumer of the ring: a blocked reader gets the
+	 * characters instead */
+	if (!mutex_trylock(&t->read_lock))
+		return 0;
 
-		count++;
+	n = ring_get(&t->input, dst_buffer, len, -1);
 
-		if (t->mode & CONSOLE_MODE_ECHO)
-			t->write(c);
+	mutex_unlock(&t->read_lock);
 
-		/* Did we read enough bytes ? */
-		if (count == len || (c == '\n' && t->mode & CONSOLE_MODE_CANON))
-			break;
-	}
+	return n;
+}
 
-	return KERNEL_OK;
+
+uint32_t console_get_dropped_characters(struct console *t)
+{
+	return t->input.dropped;
 }
 
 
@@ -124,10 +151,13 @@ void console_set_mode(struct console *cons, uint8_t mode)
 
 void console_add_character(struct console *cons, char c)
 {
-	cons->buffer[cons->buffer_write] = c;
-	cons->buffer_write++;
-
-	if (cons->buffer_write == CONSOLE_BUFFER_LENGTH)
-		cons->buffer_write = 0;
+	/* A full buffer drops the new character and keeps the unread ones */
+	if (ring_put(&cons->input, c))
+		wait_queue_wake_one(&cons->readers);
+}
 
+void console_add_characters(struct console *cons, const char *src, size_t len)
+{
+	if (ring_put_bulk(&cons->input, (const uchar_t *)src, len))
+		wait_queue_wake_one(&cons->readers);
 }
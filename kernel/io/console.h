@@ -14,6 +14,11 @@
 #define CONSOLE_MODE_CANON 1
 #define CONSOLE_MODE_ECHO  2
 
+/** Size of the input ring buffer, MUST be a power of 2 */
+#ifndef CONSOLE_BUFFER_LENGTH
+#define CONSOLE_BUFFER_LENGTH 256
+#endif
+
 struct console;
 
 ret_t console_setup(struct console **terminal_out,
@@ -21,8 +26,29 @@ ret_t console_setup(struct console **terminal_out,
 
 ret_t console_read(struct console *t, uchar_t *dst_buffer, size_t len);
 
+/**
+ * Dequeue the already received characters without blocking. Nothing is
+ * dequeued while a thread is in console_read(), the characters are its.
+ *
+ * @param t The console
+ * @param dst_buffer Destination buffer
+ * @param len Maximum number of characters to dequeue
+ * @return Number of dequeued characters
+ */
+size_t console_dequeue(struct console *t, uchar_t *dst_buffer, size_t len);
+
+/** Number of characters dropped because the input buffer was full */
+uint32_t console_get_dropped_characters(struct console *t);
+
 void console_write(struct console *t, void *src_buffer, uint16_t len);
 
+/**
+ * Queue a received character. Several producers may feed a console as
+ * long as they run with the interrupts disabled, e.g. IRQ handlers.
+ */
 void console_add_character(struct console *cons, char c);
 
+/** Queue a batch of characters and wake up the reader only once */
+void console_add_characters(struct console *cons, const char *src, size_t len);
+
 void console_set_mode(struct console *cons, uint8_t mode);
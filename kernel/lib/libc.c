@@ -7,6 +7,7 @@
 */
 
 #include <arch/x86-pc/io/vga.h>
+#include <arch/x86-pc/io/serial.h>
 #include <memory/physical-memory.h>
 
 #include "libc.h"
@@ -107,6 +108,13 @@ static char *itoa(int value, char *str, int base)
 }
 
 
+/* Display on screen and copy to the serial console if any */
+static void display_character(uchar_t c)
+{
+	vga_display_character(c);
+	serial_write_character(c);
+}
+
 void printf(const char *format, ...)
 {
 	uint8_t c;
@@ -122,7 +130,7 @@ void printf(const char *format, ...)
 	{
 		if (c != '%')
 		{
-			vga_display_character(c);
+			display_character(c);
 			continue;
 		}
 
@@ -131,7 +139,7 @@ void printf(const char *format, ...)
 		switch (c)
 		{
 			case '%':
-				vga_display_character('%');
+				display_character('%');
 				break;
 
 			case 'i':
@@ -154,11 +162,11 @@ void printf(const char *format, ...)
 
 				string:
 					while (*ptr_str)
-						vga_display_character(*ptr_str++);
+						display_character(*ptr_str++);
 				break;
 
 			default:
-				vga_display_character(*((int *)arg++));
+				display_character(*((int *)arg++));
 		}
 	}
 }
@@ -205,27 +213,175 @@ char *strzcpy(register char *dst, register const char *src, register size_t len)
 	return dst;
 }
 
+/*
+ * Word-at-a-time helpers: a 32-bit word holds 4 characters and
+ * HAS_ZERO_BYTE() is non-zero iff one of them is '\0'.
+ * @see http://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
+ */
+#define ONES_32		0x01010101UL
+#define HIGHS_32	0x80808080UL
+#define WORD_SIZE	sizeof(uint32_t)
+#define WORD_MASK	(WORD_SIZE - 1)
+
+#define HAS_ZERO_BYTE(w)	(((w) - ONES_32) & ~(w) & HIGHS_32)
+
+/* Aligned word loads may alias any character array */
+typedef uint32_t __attribute__((__may_alias__)) libc_word_t;
+
+size_t
+strlen(const char *s)
+{
+	const char *p = s;
+	const libc_word_t *w;
+
+	/* Reach a word boundary, an aligned load never crosses a page */
+	for (; (uint32_t)p & WORD_MASK; p++)
+		if (*p == '\0')
+			return p - s;
+
+	for (w = (const libc_word_t *)p; !HAS_ZERO_BYTE(*w); w++)
+		;
+
+	for (p = (const char *)w; *p; p++)
+		;
+
+	return p - s;
+}
+
 char *
 strchr(const char *s, int c)
 {
-	while (*s++)
+	const libc_word_t *w;
+	uint32_t pattern;
+	char ch = (char)c;
+
+	for (; (uint32_t)s & WORD_MASK; s++)
 	{
-		if (*s == (char)c)
+		if (*s == ch)
 			return (char *)s;
+		if (*s == '\0')
+			return NULL;
 	}
 
-	return NULL;
+	/* Skip the words holding neither the terminator nor the character */
+	pattern = (uchar_t)ch * ONES_32;
+
+	for (w = (const libc_word_t *)s;
+		!HAS_ZERO_BYTE(*w) && !HAS_ZERO_BYTE(*w ^ pattern);
+		w++)
+		;
+
+	for (s = (const char *)w; ; s++)
+	{
+		if (*s == ch)
+			return (char *)s;
+		if (*s == '\0')
+			return NULL;
+	}
 }
 
-size_t
-strlen(const char *s)
+int
+strcmp(const char *s1, const char *s2)
+{
+	/* Compare whole words when both strings share the same alignment */
+	if ((((uint32_t)s1 ^ (uint32_t)s2) & WORD_MASK) == 0)
+	{
+		const libc_word_t *w1, *w2;
+
+		for (; (uint32_t)s1 & WORD_MASK; s1++, s2++)
+			if (*s1 == '\0' || *s1 != *s2)
+				return (uchar_t)*s1 - (uchar_t)*s2;
+
+		for (w1 = (const libc_word_t *)s1, w2 = (const libc_word_t *)s2;
+			*w1 == *w2 && !HAS_ZERO_BYTE(*w1);
+			w1++, w2++)
+			;
+
+		s1 = (const char *)w1;
+		s2 = (const char *)w2;
+	}
+
+	for (; *s1 != '\0' && *s1 == *s2; s1++, s2++)
+		;
+
+	return (uchar_t)*s1 - (uchar_t)*s2;
+}
+
+int
+strncmp(const char *s1, const char *s2, size_t n)
+{
+	if ((((uint32_t)s1 ^ (uint32_t)s2) & WORD_MASK) == 0)
+	{
+		const libc_word_t *w1, *w2;
+
+		for (; n > 0 && ((uint32_t)s1 & WORD_MASK); s1++, s2++, n--)
+			if (*s1 == '\0' || *s1 != *s2)
+				return (uchar_t)*s1 - (uchar_t)*s2;
+
+		for (w1 = (const libc_word_t *)s1, w2 = (const libc_word_t *)s2;
+			n >= WORD_SIZE && *w1 == *w2 && !HAS_ZERO_BYTE(*w1);
+			w1++, w2++, n -= WORD_SIZE)
+			;
+
+		s1 = (const char *)w1;
+		s2 = (const char *)w2;
+	}
+
+	for (; n > 0; s1++, s2++, n--)
+		if (*s1 == '\0' || *s1 != *s2)
+			return (uchar_t)*s1 - (uchar_t)*s2;
+
+	return 0;
+}
+
+int
+memcmp(const void *s1, const void *s2, size_t n)
+{
+	const uchar_t *p1 = s1;
+	const uchar_t *p2 = s2;
+
+	if ((((uint32_t)p1 ^ (uint32_t)p2) & WORD_MASK) == 0)
+	{
+		const libc_word_t *w1, *w2;
+
+		for (; n > 0 && ((uint32_t)p1 & WORD_MASK); p1++, p2++, n--)
+			if (*p1 != *p2)
+				return *p1 - *p2;
+
+		for (w1 = (const libc_word_t *)p1, w2 = (const libc_word_t *)p2;
+			n >= WORD_SIZE && *w1 == *w2;
+			w1++, w2++, n -= WORD_SIZE)
+			;
+
+		p1 = (const uchar_t *)w1;
+		p2 = (const uchar_t *)w2;
+	}
+
+	for (; n > 0; p1++, p2++, n--)
+		if (*p1 != *p2)
+			return *p1 - *p2;
+
+	return 0;
+}
+
+uint64_t udiv64(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
 {
-	uint32_t length = 0;
+	uint32_t high = (uint32_t)(dividend >> 32);
+	uint32_t quotient_high, quotient_low, rest;
+
+	/* Long division in two steps, so that each divl quotient fits in
+	 * 32 bits */
+	quotient_high = high / divisor;
+	rest          = high % divisor;
+
+	asm("divl %4"
+		: "=a"(quotient_low), "=d"(rest)
+		: "0"((uint32_t)dividend), "1"(rest), "rm"(divisor));
 
-	while (*s++)
-		length++;
+	if (remainder)
+		*remainder = rest;
 
-	return length;
+	return ((uint64_t)quotient_high << 32) | quotient_low;
 }
 
 void *malloc(size_t size)
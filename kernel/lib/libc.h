@@ -85,12 +85,31 @@ void *memcpy(void *dst, const void *src, register size_t size);
 /** String copy */
 char *strzcpy(register char *dst, register const char *src, register size_t len);
 
-/** Find the first occurence of a character */
+/** Find the first occurence of a character, the terminator included */
 char *strchr(const char *s, int c);
 
 /** Calculate the length of a string */
 size_t strlen(const char *s);
 
+/** Compare two strings */
+int strcmp(const char *s1, const char *s2);
+
+/** Compare at most n characters of two strings */
+int strncmp(const char *s1, const char *s2, size_t n);
+
+/** Compare two memory areas */
+int memcmp(const void *s1, const void *s2, size_t n);
+
+/**
+ * Divide a 64 bits number by a 32 bits one, there is no libgcc to do it
+ *
+ * @param dividend The number to divide
+ * @param divisor Must not be 0
+ * @param remainder Receives the remainder if not NULL
+ * @return The quotient
+ */
+uint64_t udiv64(uint64_t dividend, uint32_t divisor, uint32_t *remainder);
+
 /**
  * Allocate memory
  *
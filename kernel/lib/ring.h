@@ -0,0 +1,173 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+/**
+ * @file ring.h
+ * @license MIT License
+ *
+ * Lock-free single-producer/single-consumer ring buffer of characters.
+ *
+ * The producer (typically an interrupt handler) only moves the head and
+ * the consumer (a thread) only moves the tail. Both indices run freely
+ * and are reduced with the mask, the size being a power of 2, so that
+ * head - tail is always the number of queued characters.
+ */
+
+#include "types.h"
+#include "libc.h"
+
+/*
+ * x86 does not reorder stores with other stores nor loads with other
+ * loads, preventing the compiler from doing it is enough.
+ */
+#define ring_barrier() asm volatile("" ::: "memory")
+
+struct ring
+{
+	volatile uint32_t head;	/**< Next slot to write, moved by the producer */
+	volatile uint32_t tail;	/**< Next slot to read, moved by the consumer */
+	uint32_t mask;		/**< Size of the ring minus 1 */
+	uint32_t dropped;	/**< Characters lost because the ring was full */
+	uchar_t *data;
+};
+
+/**
+ * Initialize an empty ring
+ *
+ * @param r The ring
+ * @param data Storage of the ring
+ * @param size Size of the storage, MUST be a power of 2
+ */
+static inline void ring_init(struct ring *r, uchar_t *data, uint32_t size)
+{
+	assert(size != 0 && (size & (size - 1)) == 0);
+
+	r->head    = 0;
+	r->tail    = 0;
+	r->mask    = size - 1;
+	r->dropped = 0;
+	r->data    = data;
+}
+
+/** Number of characters waiting in the ring */
+static inline uint32_t ring_count(const struct ring *r)
+{
+	return r->head - r->tail;
+}
+
+static inline bool_t ring_is_empty(const struct ring *r)
+{
+	return r->head == r->tail;
+}
+
+/**
+ * Producer side: queue a character, or count it as dropped when the
+ * ring is full. Unread characters are never overwritten.
+ *
+ * @return TRUE if the character has been queued
+ */
+static inline bool_t ring_put(struct ring *r, uchar_t c)
+{
+	uint32_t head = r->head;
+
+	if (head - r->tail > r->mask)
+	{
+		r->dropped++;
+		return FALSE;
+	}
+
+	r->data[head & r->mask] = c;
+
+	/* Publish the character before the new head */
+	ring_barrier();
+	r->head = head + 1;
+
+	return TRUE;
+}
+
+/**
+ * Producer side: queue up to len characters at once, the ones which
+ * don't fit are counted as dropped.
+ *
+ * @return Number of queued characters
+ */
+static inline size_t ring_put_bulk(struct ring *r, const uchar_t *src,
+		size_t len)
+{
+	uint32_t head = r->head;
+	uint32_t room = r->mask + 1 - (head - r->tail);
+	size_t i;
+
+	if (len > room)
+	{
+		r->dropped += len - room;
+		len = room;
+	}
+
+	for (i = 0; i < len; i++)
+		r->data[(head + i) & r->mask] = src[i];
+
+	/* Publish the characters before the new head */
+	ring_barrier();
+	r->head = head + len;
+
+	return len;
+}
+
+/**
+ * Consumer side: dequeue up to len characters at once.
+ *
+ * @param r The ring
+ * @param dst Destination buffer
+ * @param len Maximum number of characters to dequeue
+ * @param delimiter Stop right after this character, -1 to disable
+ * @return Number of dequeued characters
+ */
+static inline size_t ring_get(struct ring *r, uchar_t *dst, size_t len,
+		int delimiter)
+{
+	uint32_t tail = r->tail;
+	uint32_t available = r->head - tail;
+	size_t count = 0;
+
+	/* Read the characters only after having seen the head */
+	ring_barrier();
+
+	if (len > available)
+		len = available;
+
+	if (delimiter < 0)
+	{
+		uint32_t offset = tail & r->mask;
+		uint32_t first  = r->mask + 1 - offset;
+
+		/* At most two copies: up to the end of the storage and
+		 * from its beginning */
+		if (first > len)
+			first = len;
+
+		memcpy(dst, &r->data[offset], first);
+		memcpy(dst + first, r->data, len - first);
+		count = len;
+	}
+	else
+	{
+		while (count < len)
+		{
+			uchar_t c = r->data[(tail + count) & r->mask];
+
+			dst[count++] = c;
+
+			if (c == (uchar_t)delimiter)
+				break;
+		}
+	}
+
+	/* Release the slots once they have been copied */
+	ring_barrier();
+	r->tail = tail + count;
+
+	return count;
+}
+
+#endif // _RING_H_
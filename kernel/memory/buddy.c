@@ -0,0 +1,201 @@
+#include <lib/libc.h>
+#include <lib/queue.h>
+
+#include "physical-memory.h"
+#include "buddy.h"
+
+/* Page states, the order is in the lowest bits */
+#define PAGE_ORDER_MASK	0x1f
+#define PAGE_FREE_HEAD	0x80	/* First page of a free block */
+#define PAGE_USED_HEAD	0x40	/* First page of an allocated block */
+
+#define PFN(address)	((uint32_t)(address) >> X86_PAGE_SHIFT)
+#define ADDRESS(pfn)	((pfn) << X86_PAGE_SHIFT)
+
+/* Stored at the beginning of each free block */
+struct free_block
+{
+	TAILQ_ENTRY(free_block) next;
+};
+
+static TAILQ_HEAD(, free_block) free_lists[BUDDY_MAX_ORDER + 1];
+
+static struct page_frame *page_frames;
+static uint32_t nb_pages;
+static uint32_t nb_free_pages;
+
+
+static void insert_free_block(uint32_t pfn, uint32_t order)
+{
+	struct free_block *block = (struct free_block *)ADDRESS(pfn);
+
+	page_frames[pfn].state = PAGE_FREE_HEAD | order;
+	TAILQ_INSERT_HEAD(&free_lists[order], block, next);
+}
+
+static void remove_free_block(uint32_t pfn, uint32_t order)
+{
+	struct free_block *block = (struct free_block *)ADDRESS(pfn);
+
+	page_frames[pfn].state = 0;
+	TAILQ_REMOVE(&free_lists[order], block, next);
+}
+
+/* Put a block back, merging it with its free buddies */
+static void release_block(uint32_t pfn, uint32_t order)
+{
+	page_frames[pfn].state = 0;
+	nb_free_pages   += 1 << order;
+
+	while (order < BUDDY_MAX_ORDER)
+	{
+		uint32_t buddy = pfn ^ (1 << order);
+
+		if (buddy >= nb_pages
+			|| page_frames[buddy].state != (PAGE_FREE_HEAD | order))
+			break;
+
+		remove_free_block(buddy, order);
+
+		pfn &= ~(1 << order);
+		order++;
+	}
+
+	insert_free_block(pfn, order);
+}
+
+
+void buddy_setup(uint32_t nb_ram_pages, struct page_frame *frames)
+{
+	uint32_t order;
+
+	for (order = 0; order <= BUDDY_MAX_ORDER; order++)
+		TAILQ_INIT(&free_lists[order]);
+
+	page_frames   = frames;
+	nb_pages      = nb_ram_pages;
+	nb_free_pages = 0;
+
+	memset(page_frames, 0, nb_pages * sizeof(struct page_frame));
+}
+
+void buddy_add_range(paddr_t start, paddr_t end)
+{
+	uint32_t pfn      = PFN(PAGE_ALIGN_UP(start));
+	uint32_t last_pfn = PFN(PAGE_ALIGN_DOWN(end));
+
+	if (last_pfn > nb_pages)
+		last_pfn = nb_pages;
+
+	/* Cut the range into the largest aligned blocks */
+	while (pfn < last_pfn)
+	{
+		uint32_t order = 0;
+
+		while (order < BUDDY_MAX_ORDER
+			&& (pfn & (1 << order)) == 0
+			&& pfn + (2 << order) <= last_pfn)
+			order++;
+
+		release_block(pfn, order);
+		pfn += 1 << order;
+	}
+}
+
+uint32_t buddy_size_to_order(size_t size)
+{
+	uint32_t order = 0;
+
+	while ((size_t)(X86_PAGE_SIZE << order) < size && order <= BUDDY_MAX_ORDER)
+		order++;
+
+	return order;
+}
+
+void *buddy_alloc(uint32_t order)
+{
+	uint32_t current_order, pfn;
+	struct free_block *block;
+
+	/* Smallest large enough free block */
+	for (current_order = order;
+		current_order <= BUDDY_MAX_ORDER;
+		current_order++)
+	{
+		if (!TAILQ_EMPTY(&free_lists[current_order]))
+			break;
+	}
+
+	if (current_order > BUDDY_MAX_ORDER)
+		return NULL;
+
+	block = TAILQ_FIRST(&free_lists[current_order]);
+	pfn   = PFN(block);
+	remove_free_block(pfn, current_order);
+
+	/* Give the upper halves back until the block has the right size */
+	while (current_order > order)
+	{
+		current_order--;
+		insert_free_block(pfn + (1 << current_order), current_order);
+	}
+
+	page_frames[pfn].state = PAGE_USED_HEAD | order;
+	nb_free_pages   -= 1 << order;
+
+	return (void *)ADDRESS(pfn);
+}
+
+ret_t buddy_free(void *address)
+{
+	uint32_t pfn = PFN(address);
+
+	if (!IS_PAGE_ALIGNED(address)
+		|| pfn >= nb_pages
+		|| !(page_frames[pfn].state & PAGE_USED_HEAD))
+		return -KERNEL_INVALID_VALUE;
+
+	release_block(pfn, page_frames[pfn].state & PAGE_ORDER_MASK);
+
+	return KERNEL_OK;
+}
+
+struct page_frame *buddy_get_page_frame(void *address)
+{
+	uint32_t pfn = PFN(address);
+
+	if (pfn >= nb_pages)
+		return NULL;
+
+	return &page_frames[pfn];
+}
+
+size_t buddy_get_block_size(void *address)
+{
+	uint32_t pfn = PFN(address);
+
+	if (!IS_PAGE_ALIGNED(address)
+		|| pfn >= nb_pages
+		|| !(page_frames[pfn].state & PAGE_USED_HEAD))
+		return 0;
+
+	return X86_PAGE_SIZE << (page_frames[pfn].state & PAGE_ORDER_MASK);
+}
+
+uint32_t buddy_get_free_pages(void)
+{
+	return nb_free_pages;
+}
+
+int buddy_get_largest_free_order(void)
+{
+	int order;
+
+	for (order = BUDDY_MAX_ORDER; order >= 0; order--)
+	{
+		if (!TAILQ_EMPTY(&free_lists[order]))
+			return order;
+	}
+
+	return -1;
+}
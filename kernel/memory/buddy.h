@@ -0,0 +1,91 @@
+#ifndef _BUDDY_H_
+#define _BUDDY_H_
+
+/**
+ * @file buddy.h
+ * @license MIT License
+ *
+ * Binary buddy allocator of physical pages.
+ *
+ * Blocks are made of 2^order pages and aligned on their size. A free
+ * block is linked in the free list of its order through a descriptor
+ * stored in the block itself, and the state of every page (head of a
+ * free block, head of an allocated block, order) is kept in an array
+ * of page frames indexed by the page frame number. Allocation and
+ * release are thus O(log n) and freed blocks are merged with their free
+ * buddies.
+ */
+
+#include <lib/types.h>
+#include <lib/status.h>
+
+/** Largest block: 2^10 pages = 4 MiB */
+#define BUDDY_MAX_ORDER 10
+
+/** Descriptor of a physical page */
+struct page_frame
+{
+	/** Buddy allocator's state of the page */
+	uint8_t state;
+
+	/** Owner of an allocated page (e.g. its slab), NULL otherwise */
+	void *owner;
+};
+
+/**
+ * Setup an empty allocator, the free memory being given later on
+ * with buddy_add_range()
+ *
+ * @param nb_pages Number of physical pages, from address 0
+ * @param page_frames Array of nb_pages page frame descriptors
+ */
+void buddy_setup(uint32_t nb_pages, struct page_frame *page_frames);
+
+/**
+ * Hand a range of free memory over to the allocator
+ *
+ * @param start Start address, rounded up to a page boundary
+ * @param end End address, rounded down to a page boundary
+ */
+void buddy_add_range(paddr_t start, paddr_t end);
+
+/** Smallest order whose blocks can hold size bytes */
+uint32_t buddy_size_to_order(size_t size);
+
+/**
+ * Allocate a block of 2^order contiguous pages
+ *
+ * @return The block's address, or NULL if there is no large enough block
+ */
+void *buddy_alloc(uint32_t order);
+
+/**
+ * Release a block allocated by buddy_alloc()
+ *
+ * @return KERNEL_OK or -KERNEL_INVALID_VALUE if the address is not the
+ * start of an allocated block
+ */
+ret_t buddy_free(void *address);
+
+/**
+ * Descriptor of the page holding an address
+ *
+ * @return The page frame or NULL if the address is out of the RAM
+ */
+struct page_frame *buddy_get_page_frame(void *address);
+
+/**
+ * Size of an allocated block
+ *
+ * @return The size in bytes, or 0 if the address is not the start of an
+ * allocated block
+ */
+size_t buddy_get_block_size(void *address);
+
+/** Number of free pages */
+uint32_t buddy_get_free_pages(void);
+
+/** Order of the largest free block, -1 if there is no free memory */
+int buddy_get_largest_free_order(void);
+
+#endif // _BUDDY_H_
@@ -0,0 +1,142 @@
+#include <lib/libc.h>
+
+#include "physical-memory.h"
+#include "buddy.h"
+#include "frame.h"
+
+#define PFN(address)	((uint32_t)(address) >> X86_PAGE_SHIFT)
+#define ADDRESS(pfn)	((pfn) << X86_PAGE_SHIFT)
+
+#define WORD_FULL	0xFFFFFFFF
+
+/* Entirely free chunks are given back while the pool holds more */
+#define POOL_RESERVE	(2 * FRAME_CHUNK_PAGES)
+
+/* A set bit is a free frame of the pool */
+static uint32_t *bitmap;
+static uint32_t nb_words;
+static uint32_t nb_free_frames;
+
+/* All the words below the hint have no free frame */
+static uint32_t hint;
+
+/* Owner of the page frames borrowed by the pool */
+static char pool_owner;
+
+
+/* Borrow the largest possible chunk from the buddy allocator */
+static ret_t refill(void)
+{
+	int order;
+
+	for (order = FRAME_CHUNK_ORDER; order >= 0; order--)
+	{
+		void *chunk = buddy_alloc(order);
+		uint32_t pfn, i, word;
+
+		if (!chunk)
+			continue;
+
+		pfn  = PFN(chunk);
+		word = pfn / FRAME_CHUNK_PAGES;
+
+		for (i = 0; i < (1U << order); i++)
+			buddy_get_page_frame((void *)ADDRESS(pfn + i))->owner = &pool_owner;
+
+		// A chunk never crosses a word, it is aligned on its size
+		bitmap[word] |= ((1ULL << (1 << order)) - 1) << (pfn % FRAME_CHUNK_PAGES);
+		nb_free_frames += 1 << order;
+
+		if (word < hint)
+			hint = word;
+
+		return KERNEL_OK;
+	}
+
+	return -KERNEL_NO_MEMORY;
+}
+
+/* Give the chunks of an entirely free word back */
+static void release(uint32_t word)
+{
+	uint32_t pfn;
+
+	bitmap[word]    = 0;
+	nb_free_frames -= FRAME_CHUNK_PAGES;
+
+	// Only the heads of the chunks are accepted by the buddy allocator
+	for (pfn = word * FRAME_CHUNK_PAGES;
+		pfn < (word + 1) * FRAME_CHUNK_PAGES;
+		pfn++)
+	{
+		buddy_get_page_frame((void *)ADDRESS(pfn))->owner = NULL;
+		buddy_free((void *)ADDRESS(pfn));
+	}
+}
+
+
+void frame_setup(uint32_t nb_pages, uint32_t *frames_bitmap)
+{
+	bitmap         = frames_bitmap;
+	nb_words       = FRAME_BITMAP_SIZE(nb_pages) / sizeof(uint32_t);
+	nb_free_frames = 0;
+	hint           = nb_words;
+
+	memset(bitmap, 0, FRAME_BITMAP_SIZE(nb_pages));
+}
+
+void *frame_alloc(void)
+{
+	uint32_t word, bit;
+
+	if (nb_free_frames == 0 && refill() != KERNEL_OK)
+		return NULL;
+
+	// There is a free frame at or above the hint
+	for (word = hint; bitmap[word] == 0; word++)
+		;
+
+	bit = __builtin_ctz(bitmap[word]);	/* bsf */
+
+	bitmap[word] &= ~(1U << bit);
+	nb_free_frames--;
+	hint = word;
+
+	return (void *)ADDRESS(word * FRAME_CHUNK_PAGES + bit);
+}
+
+ret_t frame_free(void *address)
+{
+	uint32_t word = PFN(address) / FRAME_CHUNK_PAGES;
+	uint32_t mask = 1U << (PFN(address) % FRAME_CHUNK_PAGES);
+	struct page_frame *frame = buddy_get_page_frame(address);
+
+	if (!IS_PAGE_ALIGNED(address)
+		|| !frame
+		|| frame->owner != &pool_owner
+		|| (bitmap[word] & mask))
+		return -KERNEL_INVALID_VALUE;
+
+	bitmap[word] |= mask;
+	nb_free_frames++;
+
+	if (word < hint)
+		hint = word;
+
+	if (bitmap[word] == WORD_FULL && nb_free_frames > POOL_RESERVE)
+		release(word);
+
+	return KERNEL_OK;
+}
+
+bool_t frame_is_pool_page(const void *address)
+{
+	struct page_frame *frame = buddy_get_page_frame((void *)address);
+
+	return frame && frame->owner == &pool_owner;
+}
+
+uint32_t frame_get_free_frames(void)
+{
+	return nb_free_frames;
+}
@@ -0,0 +1,59 @@
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+/**
+ * @file frame.h
+ * @license MIT License
+ *
+ * Bitmap allocator of single physical page frames.
+ *
+ * One bit per page of RAM tells whether the frame is free in the pool.
+ * The pool borrows aligned chunks of 32 pages, that is one word of the
+ * bitmap, from the buddy allocator and gives them back once they are
+ * entirely free again. A free frame is found by scanning the bitmap a
+ * word at a time from a hint cursor, below which all the words are
+ * known to be empty, and bsf gives the free bit of the word.
+ */
+
+#include <lib/types.h>
+#include <lib/status.h>
+
+/** Chunks borrowed from the buddy allocator: 2^5 = 32 frames */
+#define FRAME_CHUNK_ORDER 5
+#define FRAME_CHUNK_PAGES (1 << FRAME_CHUNK_ORDER)
+
+/** Size in bytes of the bitmap for nb_pages pages */
+#define FRAME_BITMAP_SIZE(nb_pages) \
+	((((nb_pages) + FRAME_CHUNK_PAGES - 1) / FRAME_CHUNK_PAGES) \
+	 * sizeof(uint32_t))
+
+/**
+ * Setup an empty pool, the buddy allocator must be ready
+ *
+ * @param nb_pages Number of physical pages, from address 0
+ * @param bitmap FRAME_BITMAP_SIZE(nb_pages) bytes
+ */
+void frame_setup(uint32_t nb_pages, uint32_t *bitmap);
+
+/**
+ * Allocate a page frame
+ *
+ * @return The frame's address or NULL if the memory is exhausted
+ */
+void *frame_alloc(void);
+
+/**
+ * Release a frame allocated by frame_alloc()
+ *
+ * @return KERNEL_OK or -KERNEL_INVALID_VALUE if the frame doesn't come
+ * from the pool or is already free
+ */
+ret_t frame_free(void *address);
+
+/** Whether a page frame belongs to the pool, allocated or not */
+bool_t frame_is_pool_page(const void *address);
+
+/** Number of free frames held by the pool */
+uint32_t frame_get_free_frames(void);
+
+#endif // _FRAME_H_
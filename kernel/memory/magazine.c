@@ -0,0 +1,128 @@
+#include <lib/libc.h>
+#include <threading/spinlock.h>
+
+#include "buddy.h"
+#include "slab.h"
+#include "magazine.h"
+
+#if MAGAZINE_MAX_SIZE != (SLAB_MIN_SIZE << (MAGAZINE_NB_CLASSES - 1))
+#error "MAGAZINE_MAX_SIZE must be the size of the last cached class"
+#endif
+
+/* Magazines of the running thread, NULL until threading is setup */
+static struct magazines *current_magazines;
+
+
+static uint32_t size_to_class(size_t size)
+{
+	uint32_t class = 0;
+
+	while ((size_t)(SLAB_MIN_SIZE << class) < size)
+		class++;
+
+	return class;
+}
+
+/* Move a batch of objects from the slab caches, heap_lock held */
+static void refill(struct magazine *magazine, uint32_t class)
+{
+	while (magazine->count < MAGAZINE_BATCH)
+	{
+		void *object = slab_alloc(SLAB_MIN_SIZE << class);
+
+		if (!object)
+			break;
+
+		magazine->objects[magazine->count++] = object;
+	}
+}
+
+/* Move a batch of objects to the slab caches, heap_lock held */
+static void drain(struct magazine *magazine, uint32_t count)
+{
+	while (count-- > 0)
+	{
+		void *object = magazine->objects[--magazine->count];
+
+		slab_free(object, buddy_get_page_frame(object)->owner);
+	}
+}
+
+
+void magazine_init(struct magazines *magazines)
+{
+	memset(magazines, 0, sizeof(struct magazines));
+}
+
+void magazine_set_current(struct magazines *magazines)
+{
+	current_magazines = magazines;
+}
+
+void *magazine_alloc(size_t size)
+{
+	struct magazines *magazines = current_magazines;
+	struct magazine *magazine;
+	uint32_t class;
+	void *object;
+
+	if (!magazines)
+		return NULL;
+
+	class    = size_to_class(size);
+	magazine = &magazines->classes[class];
+
+	if (magazine->count == 0)
+	{
+		spin_lock(&heap_lock);
+		refill(magazine, class);
+		spin_unlock(&heap_lock);
+
+		if (magazine->count == 0)
+			return NULL;
+	}
+
+	object = magazine->objects[--magazine->count];
+	slab_claim_object(object, buddy_get_page_frame(object)->owner);
+
+	return object;
+}
+
+bool_t magazine_free(void *object, void *owner)
+{
+	struct magazines *magazines = current_magazines;
+	struct magazine *magazine;
+	size_t size = slab_get_object_size(owner);
+
+	if (!magazines || size > MAGAZINE_MAX_SIZE)
+		return FALSE;
+
+	magazine = &magazines->classes[size_to_class(size)];
+
+	if (magazine->count == MAGAZINE_SIZE)
+	{
+		spin_lock(&heap_lock);
+		drain(magazine, MAGAZINE_BATCH);
+		spin_unlock(&heap_lock);
+	}
+
+	magazine->objects[magazine->count++] = object;
+
+	return TRUE;
+}
+
+void magazine_drain(struct magazines *magazines)
+{
+	uint32_t class;
+
+	spin_lock(&heap_lock);
+
+	for (class = 0; class < MAGAZINE_NB_CLASSES; class++)
+	{
+		struct magazine *magazine = &magazines->classes[class];
+
+		drain(magazine, magazine->count);
+	}
+
+	spin_unlock(&heap_lock);
+}
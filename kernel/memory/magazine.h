@@ -0,0 +1,73 @@
+#ifndef _MAGAZINE_H_
+#define _MAGAZINE_H_
+
+/**
+ * @file magazine.h
+ * @license MIT License
+ *
+ * Per-thread caches of small objects in front of the slab caches.
+ *
+ * Each thread owns a magazine, a small stack of free objects, for each
+ * of the hottest size classes. Objects are taken from and given back to
+ * the running thread's magazine without touching any shared state nor
+ * disabling the interrupts, the slab caches being only reached in
+ * batches when a magazine is empty or full. Interrupt handlers must not
+ * allocate memory since they would use the interrupted thread's
+ * magazines.
+ */
+
+#include <lib/types.h>
+
+/** Size classes cached: 16, 32, 64 and 128 bytes */
+#define MAGAZINE_NB_CLASSES 4
+#define MAGAZINE_MAX_SIZE   128
+
+/** Objects in a magazine, half of them move at once from or to slabs */
+#define MAGAZINE_SIZE       16
+#define MAGAZINE_BATCH      (MAGAZINE_SIZE / 2)
+
+struct magazine
+{
+	uint32_t count;
+	void *objects[MAGAZINE_SIZE];
+};
+
+/** The magazines of a thread */
+struct magazines
+{
+	struct magazine classes[MAGAZINE_NB_CLASSES];
+};
+
+/** Setup empty magazines */
+void magazine_init(struct magazines *magazines);
+
+/**
+ * Select the magazines used by the allocations from now on, called
+ * on each context switch
+ */
+void magazine_set_current(struct magazines *magazines);
+
+/**
+ * Allocate an object from the current magazines, refilled from the
+ * slab caches when empty
+ *
+ * @param size Number of bytes, at most MAGAZINE_MAX_SIZE
+ * @return The object or NULL if there are no magazines yet or no memory
+ */
+void *magazine_alloc(size_t size);
+
+/**
+ * Give an object back to the current magazines, half of a full
+ * magazine being drained to the slab caches first
+ *
+ * @param object The object, already released with slab_release_object()
+ * @param owner The page frame owner of the object, @see slab_free()
+ * @return FALSE if the object is not cached, and must be given to the
+ * slab caches by the caller
+ */
+bool_t magazine_free(void *object, void *owner);
+
+/** Give all the cached objects back to the slab caches */
+void magazine_drain(struct magazines *magazines);
+
+#endif // _MAGAZINE_H_
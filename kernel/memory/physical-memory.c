@@ -1,11 +1,18 @@
 #include <lib/libc.h>
 #include <lib/status.h>
 #include <lib/queue.h>
+#include <threading/spinlock.h>
 
 #include "physical-memory.h"
+#include "buddy.h"
+#include "slab.h"
+#include "frame.h"
+#include "magazine.h"
 
-TAILQ_HEAD(, memory_range) free_memory_ranges;
-TAILQ_HEAD(, memory_range) used_memory_ranges;
+/* Descriptors of the physical memory layout, only used during setup */
+#define MEMORY_RANGES_MAX 64
+
+TAILQ_HEAD(memory_ranges, memory_range);
 
 struct memory_range
 {
@@ -15,7 +22,23 @@ struct memory_range
 	TAILQ_ENTRY(memory_range) next;
 };
 
-uint32_t heap = 0x0;
+static struct memory_ranges free_memory_ranges;
+static struct memory_ranges used_memory_ranges;
+
+/* Pool of descriptors, the unused ones being recycled */
+static struct memory_range memory_ranges_pool[MEMORY_RANGES_MAX];
+static struct memory_ranges unused_memory_ranges;
+
+/* End of the highest usable RAM region */
+static paddr_t ram_end;
+
+/* Updated by a single instruction, which can't be interrupted, so that
+ * the counters stay exact on a uniprocessor without disabling the
+ * interrupts on the magazines' fast path */
+#define STAT_ADD(counter, value) \
+	asm volatile("addl %1, %0" : "+m"(counter) : "ir"((uint32_t)(value)))
+
+static struct heap_statistics statistics;
 
 // Kernel beginning marker  @see linker.ld
 extern char __kernel_start;
@@ -24,149 +47,401 @@ extern char __kernel_start;
 extern char __kernel_end;
 
 
-void physical_memory_setup(uint32_t ram_size,
+static struct memory_range *memory_range_new(struct memory_ranges *list,
+	uint32_t base_address,
+	uint32_t size)
+{
+	struct memory_range *range;
+
+	range = TAILQ_FIRST(&unused_memory_ranges);
+
+	if (!range)
+		panic("Too many physical memory ranges");
+
+	TAILQ_REMOVE(&unused_memory_ranges, range, next);
+
+	range->base_address = base_address;
+	range->size         = size;
+
+	TAILQ_INSERT_TAIL(list, range, next);
+
+	return range;
+}
+
+static void memory_range_delete(struct memory_ranges *list,
+	struct memory_range *range)
+{
+	TAILQ_REMOVE(list, range, next);
+	TAILQ_INSERT_HEAD(&unused_memory_ranges, range, next);
+}
+
+/* Remove [start, end[ from the free ranges and record it as used */
+static void reserve_memory_range(uint32_t start, uint32_t end)
+{
+	struct memory_range *range, *next_range;
+
+	start = PAGE_ALIGN_DOWN(start);
+	end   = PAGE_ALIGN_UP(end);
+
+	if (start >= end)
+		return;
+
+	for (range = TAILQ_FIRST(&free_memory_ranges); range; range = next_range)
+	{
+		uint32_t range_end = range->base_address + range->size;
+
+		next_range = TAILQ_NEXT(range, next);
+
+		if (end <= range->base_address || start >= range_end)
+			continue;
+
+		// Keep the part after the reserved area, if any
+		if (end < range_end)
+			memory_range_new(&free_memory_ranges, end, range_end - end);
+
+		// Keep the part before, if any
+		if (start > range->base_address)
+			range->size = start - range->base_address;
+		else
+			memory_range_delete(&free_memory_ranges, range);
+	}
+
+	memory_range_new(&used_memory_ranges, start, end - start);
+}
+
+/* Reserve size bytes for the allocator's own bookkeeping */
+static void *reserve_metadata(uint32_t size)
+{
+	struct memory_range *range;
+	uint32_t base_address;
+
+	size = PAGE_ALIGN_UP(size);
+
+	TAILQ_FOREACH(range, &free_memory_ranges, next)
+	{
+		if (range->size >= size)
+		{
+			base_address = range->base_address;
+			reserve_memory_range(base_address, base_address + size);
+
+			return (void *)base_address;
+		}
+	}
+
+	panic("No memory for the page frames");
+}
+
+
+/* Free ranges out of the memory map, returns the number of pages */
+static uint32_t add_memory_map_ranges(const multiboot_info_t *mbi)
+{
+	uint32_t address = mbi->mmap_addr;
+	uint32_t mmap_end = mbi->mmap_addr + mbi->mmap_length;
+	uint32_t ram_end = 0;
+
+	while (address < mmap_end)
+	{
+		const multiboot_memory_map_t *entry = (void *)address;
+		uint64_t start = entry->base_address;
+		uint64_t end   = entry->base_address + entry->length;
+
+		address += entry->size + sizeof(entry->size);
+
+		// Reserved, ACPI and bad regions are never handed out, and
+		// the memory above 4 GiB can't be reached without PAE
+		if (entry->type != MULTIBOOT_MEMORY_AVAILABLE || start >= MEMORY_LIMIT)
+			continue;
+
+		// The last page is left out so that the end fits in 32 bits
+		if (end > MEMORY_LIMIT)
+			end = MEMORY_LIMIT;
+
+		start = PAGE_ALIGN_UP((uint32_t)start);
+		end   = PAGE_ALIGN_DOWN((uint32_t)end);
+
+		if (end <= start)
+			continue;
+
+		memory_range_new(&free_memory_ranges, start, end - start);
+
+		if (end > ram_end)
+			ram_end = end;
+	}
+
+	return ram_end >> X86_PAGE_SHIFT;
+}
+
+/* Without memory map: the upper memory stops at the first hole */
+static uint32_t add_default_ranges(const multiboot_info_t *mbi)
+{
+	uint32_t ram_size = PAGE_ALIGN_DOWN((mbi->mem_upper << 10) + (1 << 20));
+
+	// Free : base ... BIOS
+	memory_range_new(&free_memory_ranges, 0, BIOS_VIDEO_START);
+
+	// Free : BIOS ... end of RAM
+	memory_range_new(&free_memory_ranges,
+		BIOS_VIDEO_END, ram_size - BIOS_VIDEO_END);
+
+	return ram_size >> X86_PAGE_SHIFT;
+}
+
+
+void physical_memory_setup(const multiboot_info_t *mbi,
 	uint32_t initrd_start,
 	uint32_t initrd_end)
 {
-	struct memory_range *r1, *r2, *r3, *r4, *r5, *r6, *r7, *r8;
-	paddr_t *kernel_top_address = (paddr_t *)&initrd_end;
+	struct memory_range *mem_range;
+	struct page_frame *page_frames;
+	uint32_t *frames_bitmap;
+	uint32_t nb_pages;
+	uint32_t i;
 
 	TAILQ_INIT(&free_memory_ranges);
 	TAILQ_INIT(&used_memory_ranges);
+	TAILQ_INIT(&unused_memory_ranges);
 
-	heap = PAGE_ALIGN_UP(*kernel_top_address);
+	for (i = 0; i < MEMORY_RANGES_MAX; i++)
+		TAILQ_INSERT_TAIL(&unused_memory_ranges, &memory_ranges_pool[i], next);
 
-	// Reserved : 0 ... base
-	r1 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	// Usable RAM regions, in a single pass over the memory map
+	if (mbi->flags & MULTIBOOT_INFO_MEM_MAP)
+		nb_pages = add_memory_map_ranges(mbi);
+	else
+		nb_pages = add_default_ranges(mbi);
 
-	r1->base_address = X86_PAGE_SIZE;
-	r1->size = X86_PAGE_SIZE;
+	ram_end = nb_pages << X86_PAGE_SHIFT;
 
-	// Free : base ... BIOS
-	r2 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	// Used : the first page, to catch NULL pointers
+	reserve_memory_range(0, X86_PAGE_SIZE);
 
-	r2->base_address = r2->base_address;
-	r2->size = BIOS_VIDEO_START - r2->base_address;
+	// Used : Kernel code/data/bss
+	reserve_memory_range((paddr_t)(&__kernel_start),
+		(paddr_t)(&__kernel_end));
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r2, next);
+	// Used: Initrd
+	reserve_memory_range(initrd_start, initrd_end);
 
-	// Used : BIOS
-	r3 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	// Used : the page frame descriptors, the allocators' only
+	// out-of-band metadata, sized once for all from the RAM size
+	page_frames = reserve_metadata(nb_pages * sizeof(struct page_frame));
+	frames_bitmap = reserve_metadata(FRAME_BITMAP_SIZE(nb_pages));
 
-	r3->base_address = BIOS_VIDEO_START;
-	r3->size = BIOS_VIDEO_END - BIOS_VIDEO_START;
+	// Hand the free ranges over to the page allocator
+	buddy_setup(nb_pages, page_frames);
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r3, next);
+	TAILQ_FOREACH(mem_range, &free_memory_ranges, next)
+	{
+		buddy_add_range(mem_range->base_address,
+			mem_range->base_address + mem_range->size);
+	}
 
-	// Free : BIOS ... kernel
-	r4 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	// Single frames are handed out of a bitmap of borrowed chunks
+	frame_setup(nb_pages, frames_bitmap);
 
-	r4->base_address = BIOS_VIDEO_END;
-	r4->size = (uint32_t)(&__kernel_start) - BIOS_VIDEO_END;
+	// Small objects are carved in pages by the size-class caches
+	slab_setup();
+}
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r4, next);
 
-	// Used: Initrd
-	r5 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+/* Size of the block actually granted for a request */
+static size_t granted_size(size_t size)
+{
+	size_t granted = SLAB_MIN_SIZE;
 
-	r5->base_address = initrd_start;
-	r5->size = initrd_end - initrd_start;
+	if (size > SLAB_MAX_SIZE)
+		return X86_PAGE_SIZE << buddy_size_to_order(size);
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r5, next);
+	while (granted < size)
+		granted <<= 1;
 
-	// Used : Kernel code/data/bss + physcal page descr array
-	r6 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	return granted;
+}
 
-	r6->base_address = (paddr_t)(& __kernel_start);
-	r6->size = (paddr_t)(& __kernel_end);
+/* Histogram bucket of a requested size: <= 16 B, <= 32 B, ... */
+static uint32_t size_to_bucket(size_t size)
+{
+	uint32_t bucket;
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r6, next);
+	if (size <= SLAB_MIN_SIZE)
+		return 0;
 
-	// Free : first page of descr ... end of RAM
-	r7 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	bucket = 32 - __builtin_clz(size - 1) - 4;
 
-	r7->base_address = (paddr_t)(&__kernel_end);
-	r7->size = initrd_start - (paddr_t)(&__kernel_end);
+	if (bucket >= HEAP_HISTOGRAM_BUCKETS)
+		bucket = HEAP_HISTOGRAM_BUCKETS - 1;
 
-	r8 = (struct memory_range *)heap;
-	heap += sizeof(struct memory_range);
+	return bucket;
+}
 
-	// Ensure that the RAM size is page aligned
-	ram_size = PAGE_ALIGN_DOWN(ram_size);
+static void account_allocation(size_t size, void *object)
+{
+	STAT_ADD(statistics.size_histogram[size_to_bucket(size)], 1);
+
+	if (!object)
+	{
+		STAT_ADD(statistics.nb_failed_allocations, 1);
+		return;
+	}
 
-	r8->base_address = initrd_end;
-	r8->size = ram_size - initrd_end;
+	STAT_ADD(statistics.nb_allocations, 1);
+	STAT_ADD(statistics.bytes_in_use, granted_size(size));
 
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r7, next);
-	TAILQ_INSERT_TAIL(&free_memory_ranges, r8, next);
+	// May miss a peak reached by an interrupting thread, good enough
+	if (statistics.bytes_in_use > statistics.peak_bytes_in_use)
+		statistics.peak_bytes_in_use = statistics.bytes_in_use;
 }
 
 
 void *heap_alloc(size_t size)
 {
-	struct memory_range *mem_range, *place;
+	void *object = NULL;
 
-	if (size == 0 || TAILQ_EMPTY(&free_memory_ranges))
+	if (size == 0)
 		return NULL;
 
-	// First round: matching for the exact space
-	TAILQ_FOREACH(mem_range, &free_memory_ranges, next)
+	// Fast path: the running thread's own cache, no shared state
+	if (size <= MAGAZINE_MAX_SIZE)
+		object = magazine_alloc(size);
+
+	if (!object)
 	{
-		if (mem_range->size == size)
-		{
-			TAILQ_REMOVE(&free_memory_ranges, mem_range, next);
-			TAILQ_INSERT_TAIL(&used_memory_ranges, mem_range, next);
+		spin_lock(&heap_lock);
 
-			return (void *)mem_range->base_address;
-		}
+		if (size <= SLAB_MAX_SIZE)
+			object = slab_alloc(size);
+		else
+			object = buddy_alloc(buddy_size_to_order(size));
+
+		spin_unlock(&heap_lock);
 	}
 
-	// Second round: First-fit method
-	TAILQ_FOREACH(mem_range, &free_memory_ranges, next)
-	{
-		if (mem_range->size >= size)
-		{
-			// Resize the current memory range
-			mem_range->size = mem_range->size - size;
+	account_allocation(size, object);
 
-			// Allocate a new chunk
-			place = (struct memory_range *)heap;
-			heap += sizeof(struct memory_range);
+	return object;
+}
 
-			place->base_address = mem_range->base_address + mem_range->size;
-			place->size = size;
 
-			// Update the list
-			TAILQ_INSERT_TAIL(&used_memory_ranges, place, next);
+void heap_free(void *address)
+{
+	struct page_frame *frame;
+	size_t size;
 
-			return (void *)place->base_address;
-		}
+	if (address == NULL)
+		return;
+
+	frame = buddy_get_page_frame(address);
+
+	if (!frame)
+		return;
+
+	// Objects of a slab, or blocks of pages. The blocks' state is
+	// checked so that a double free is caught before any damage. The
+	// frames of the pool are not the heap's, their owner isn't a slab.
+	if (frame_is_pool_page(address))
+		size = 0;
+	else if (frame->owner)
+	{
+		size = slab_get_object_size(frame->owner);
+
+		if (slab_release_object(address, frame->owner) != KERNEL_OK)
+			size = 0;
 	}
+	else
+		size = buddy_get_block_size(address);
+
+	if (size == 0)
+	{
+		printf(">> heap_free: invalid or double free of %x <<\n", address);
+		return;
+	}
+
+	STAT_ADD(statistics.bytes_in_use, -size);
+	STAT_ADD(statistics.nb_frees, 1);
+
+	if (frame->owner && magazine_free(address, frame->owner))
+		return;
+
+	spin_lock(&heap_lock);
+
+	if (frame->owner)
+		slab_free(address, frame->owner);
+	else
+		buddy_free(address);
 
-	return NULL;
+	spin_unlock(&heap_lock);
 }
 
 
-void heap_free(void *address)
+void heap_get_statistics(struct heap_statistics *stats)
 {
-	struct memory_range *mem_range;
+	int order;
 
-	if (address == NULL)
-		return;
+	spin_lock(&heap_lock);
+
+	*stats = statistics;
+
+	order = buddy_get_largest_free_order();
+	stats->largest_free_block = (order < 0) ? 0 : X86_PAGE_SIZE << order;
+	stats->free_bytes = buddy_get_free_pages() << X86_PAGE_SHIFT;
 
-	TAILQ_FOREACH(mem_range, &used_memory_ranges, next)
+	spin_unlock(&heap_lock);
+}
+
+
+void heap_dump_statistics(void)
+{
+	struct heap_statistics stats;
+	uint32_t i;
+
+	heap_get_statistics(&stats);
+
+	printf("Heap: %d B used, %d B peak, %d B free, largest block %d B\n",
+		stats.bytes_in_use, stats.peak_bytes_in_use,
+		stats.free_bytes, stats.largest_free_block);
+	printf("%d allocations, %d frees, %d failed\n",
+		stats.nb_allocations, stats.nb_frees,
+		stats.nb_failed_allocations);
+
+	// Two lines of 8 buckets: 16 B to 2 KiB, then 4 KiB and more
+	for (i = 0; i < HEAP_HISTOGRAM_BUCKETS; i++)
 	{
-		if (mem_range->base_address == (uint32_t)address)
-		{
-			TAILQ_REMOVE(&used_memory_ranges, mem_range, next);
-			TAILQ_INSERT_TAIL(&free_memory_ranges, mem_range, next);
-		}
+		if (i % 8 == 0)
+			printf(i ? "\n>%d KiB: " : "<=%d B: ",
+				i ? (SLAB_MIN_SIZE << (i - 1)) / 1024 : SLAB_MIN_SIZE);
+
+		printf("%d ", stats.size_histogram[i]);
 	}
+
+	printf("\n");
+}
+
+
+paddr_t physical_memory_get_ram_end(void)
+{
+	return ram_end;
+}
+
+
+void *physical_memory_page_reference_new(void)
+{
+	void *page;
+
+	spin_lock(&heap_lock);
+	page = frame_alloc();
+	spin_unlock(&heap_lock);
+
+	return page;
+}
+
+
+ret_t physical_memory_page_unreference(paddr_t address)
+{
+	ret_t status;
+
+	spin_lock(&heap_lock);
+	status = frame_free((void *)address);
+	spin_unlock(&heap_lock);
+
+	return status;
 }
@@ -11,6 +11,7 @@
 
 #include <lib/types.h>
 #include <lib/queue.h>
+#include <arch/x86-pc/bootstrap/multiboot.h>
 
 /** Each page is 4kb */
 #define X86_PAGE_SIZE  (4*1024)
@@ -27,6 +28,9 @@
 #define BIOS_VIDEO_START 0xa0000
 #define BIOS_VIDEO_END   0x100000
 
+/** Limit of the usable 32 bits physical address space */
+#define MEMORY_LIMIT 0xFFFFF000ULL
+
 /** Align on a boundary (MUST be a power of 2), so that return value <= val */
 #define __PAGE_ALIGN_LOWER(value, boundary) \
   (((unsigned)(value)) & (~((boundary)-1)))
@@ -50,27 +54,85 @@
 
 /**
  * Setup the management of physical pages.
- * It preserves BIOS and Video address ranges from memory
- * allocation requests.
+ * The usable RAM regions come from the Multiboot memory map, so that
+ * reserved and ACPI regions and the holes are skipped. Without memory
+ * map, BIOS and Video address ranges are preserved from memory
+ * allocation requests and the RAM stops at the first hole.
  * We use a "flat memory model" so virtual address == physical address
  *
- * @param ram_size Amount of the RAM
- *
- * @param kernel_core_top Kernel's top address for identity mapping
+ * @param mbi The Multiboot information
  *
  * @param initrd_start Start address of RAMFS
  *
  * @param initrd_end End address of RAMFS
  *
  */
-void physical_memory_setup(uint32_t ram_size,
+void physical_memory_setup(const multiboot_info_t *mbi,
 	uint32_t initrd_start,
 	uint32_t initrd_end);
 
-/** Allocate memory on the heap */
+/** Requested sizes are counted by powers of 2, from 16 B to 512 KiB */
+#define HEAP_HISTOGRAM_BUCKETS 16
+
+/** Heap usage counters */
+struct heap_statistics
+{
+	/** Bytes of the granted blocks, rounded up to their size class */
+	uint32_t bytes_in_use;
+	uint32_t peak_bytes_in_use;
+
+	uint32_t nb_allocations;
+	uint32_t nb_frees;
+	uint32_t nb_failed_allocations;
+
+	/** Free memory of the page allocator */
+	uint32_t free_bytes;
+	uint32_t largest_free_block;
+
+	/** Requests of at most 16 B, 32 B, ..., the last bucket takes the
+	 * bigger ones */
+	uint32_t size_histogram[HEAP_HISTOGRAM_BUCKETS];
+};
+
+/** End address of the highest usable RAM region */
+paddr_t physical_memory_get_ram_end(void);
+
+/**
+ * Allocate memory on the heap
+ *
+ * @param size Number of bytes. Up to MAGAZINE_MAX_SIZE, the object
+ * comes from the running thread's magazines, up to SLAB_MAX_SIZE from a
+ * size-class cache, bigger requests get a block of 2^n pages
+ * @return The address of the block or NULL
+ */
 void *heap_alloc(size_t size);
 
-/** Free memory by releasing some heap */
+/**
+ * Free memory by releasing some heap, in constant time: the page frame
+ * of the address tells its slab or block. Invalid and double frees are
+ * reported and ignored
+ */
 void heap_free(void *ptr);
 
+/** Get a snapshot of the heap usage counters */
+void heap_get_statistics(struct heap_statistics *stats);
+
+/** Print the heap usage counters at the current screen position */
+void heap_dump_statistics(void);
+
+/**
+ * Allocate a physical page frame
+ *
+ * @return The address of the page or NULL if the memory is exhausted
+ */
+void *physical_memory_page_reference_new(void);
+
+/**
+ * Release a page frame allocated by physical_memory_page_reference_new()
+ *
+ * @return KERNEL_OK or -KERNEL_INVALID_VALUE if the address is not an
+ * allocated page frame
+ */
+ret_t physical_memory_page_unreference(paddr_t address);
+
 #endif // _PHYSICAL_MEMORY_H_
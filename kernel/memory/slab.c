@@ -0,0 +1,253 @@
+#include <lib/libc.h>
+#include <lib/queue.h>
+#include <lib/status.h>
+#include <threading/spinlock.h>
+
+#include "physical-memory.h"
+#include "buddy.h"
+#include "slab.h"
+
+/* A slab holds at least this many objects */
+#define SLAB_MIN_OBJECTS 8
+
+/* Objects are aligned on this boundary after the slab header */
+#define SLAB_ALIGNMENT   16
+
+/* The allocation bitmap covers the smallest objects of a page */
+#define SLAB_MAX_OBJECTS 256
+
+struct slab;
+
+struct slab_cache
+{
+	size_t   object_size;
+	uint32_t object_shift;
+	uint32_t slab_order;
+	uint32_t objects_offset;
+	uint32_t objects_per_slab;
+
+	/* Slabs having at least one free object */
+	TAILQ_HEAD(, slab) partial_slabs;
+};
+
+/* Stored at the beginning of the slab's pages */
+struct slab
+{
+	struct slab_cache *cache;
+
+	/* Free objects, the link being stored in the object itself */
+	void    *free_objects;
+	uint32_t nb_used;
+
+	TAILQ_ENTRY(slab) next;
+
+	/* Objects handed out, and not given back since, to catch double
+	 * frees: a set bit per object */
+	uint32_t allocated[SLAB_MAX_OBJECTS / 32];
+};
+
+static struct slab_cache caches[SLAB_NB_CACHES];
+
+struct spinlock heap_lock = SPINLOCK_INITIALIZER;
+
+
+/* Index of an object in its slab, -1 if the address isn't an object */
+static int object_index(struct slab *slab, void *object)
+{
+	struct slab_cache *cache = slab->cache;
+	uint32_t offset = (char *)object - (char *)slab - cache->objects_offset;
+	uint32_t index  = offset >> cache->object_shift;
+
+	if ((char *)object < (char *)slab + cache->objects_offset
+		|| (offset & (cache->object_size - 1))
+		|| index >= cache->objects_per_slab)
+		return -1;
+
+	return index;
+}
+
+/* Single instructions, they can't be interrupted on a uniprocessor */
+static inline void set_allocated(struct slab *slab, uint32_t index)
+{
+	asm volatile("btsl %1, %0"
+		: "+m"(slab->allocated[0]) : "r"(index) : "memory", "cc");
+}
+
+static inline bool_t test_and_clear_allocated(struct slab *slab,
+	uint32_t index)
+{
+	uint8_t was_set;
+
+	asm volatile("btrl %2, %0 ; setc %1"
+		: "+m"(slab->allocated[0]), "=q"(was_set)
+		: "r"(index) : "memory", "cc");
+
+	return was_set ? TRUE : FALSE;
+}
+
+
+static struct slab_cache *size_to_cache(size_t size)
+{
+	uint32_t index = 0;
+
+	while ((size_t)(SLAB_MIN_SIZE << index) < size)
+		index++;
+
+	return &caches[index];
+}
+
+static void set_pages_owner(struct slab *slab, void *owner)
+{
+	uint32_t i;
+
+	for (i = 0; i < (1U << slab->cache->slab_order); i++)
+	{
+		buddy_get_page_frame((char *)slab + (i << X86_PAGE_SHIFT))->owner
+			= owner;
+	}
+}
+
+static struct slab *slab_create(struct slab_cache *cache)
+{
+	struct slab *slab;
+	char *object;
+	uint32_t i;
+
+	slab = buddy_alloc(cache->slab_order);
+
+	if (!slab)
+		return NULL;
+
+	slab->cache        = cache;
+	slab->free_objects = NULL;
+	slab->nb_used      = 0;
+	memset(slab->allocated, 0, sizeof(slab->allocated));
+
+	/* Thread the free list so that objects are used in address order */
+	object = (char *)slab + cache->objects_offset
+		+ (cache->objects_per_slab - 1) * cache->object_size;
+
+	for (i = 0; i < cache->objects_per_slab; i++)
+	{
+		*(void **)object   = slab->free_objects;
+		slab->free_objects = object;
+		object            -= cache->object_size;
+	}
+
+	set_pages_owner(slab, slab);
+	TAILQ_INSERT_HEAD(&cache->partial_slabs, slab, next);
+
+	return slab;
+}
+
+static void slab_destroy(struct slab *slab)
+{
+	TAILQ_REMOVE(&slab->cache->partial_slabs, slab, next);
+	set_pages_owner(slab, NULL);
+	buddy_free(slab);
+}
+
+
+void slab_setup(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < SLAB_NB_CACHES; i++)
+	{
+		struct slab_cache *cache = &caches[i];
+
+		cache->object_size    = SLAB_MIN_SIZE << i;
+		cache->object_shift   = __builtin_ctz(cache->object_size);
+		cache->objects_offset = __PAGE_ALIGN_UPPER(sizeof(struct slab),
+						SLAB_ALIGNMENT);
+		cache->slab_order     = 0;
+
+		while ((X86_PAGE_SIZE << cache->slab_order) - cache->objects_offset
+			< SLAB_MIN_OBJECTS * cache->object_size)
+			cache->slab_order++;
+
+		cache->objects_per_slab = ((X86_PAGE_SIZE << cache->slab_order)
+			- cache->objects_offset) / cache->object_size;
+
+		assert(cache->objects_per_slab <= SLAB_MAX_OBJECTS);
+
+		TAILQ_INIT(&cache->partial_slabs);
+	}
+}
+
+void *slab_alloc(size_t size)
+{
+	struct slab_cache *cache;
+	struct slab *slab;
+	void *object;
+
+	if (size == 0 || size > SLAB_MAX_SIZE)
+		return NULL;
+
+	cache = size_to_cache(size);
+	slab  = TAILQ_FIRST(&cache->partial_slabs);
+
+	if (!slab)
+	{
+		slab = slab_create(cache);
+
+		if (!slab)
+			return NULL;
+	}
+
+	object             = slab->free_objects;
+	slab->free_objects = *(void **)object;
+	slab->nb_used++;
+	set_allocated(slab, object_index(slab, object));
+
+	/* Full slabs are only found again through their objects */
+	if (!slab->free_objects)
+		TAILQ_REMOVE(&cache->partial_slabs, slab, next);
+
+	return object;
+}
+
+void slab_free(void *object, void *owner)
+{
+	struct slab *slab = owner;
+	struct slab_cache *cache = slab->cache;
+
+	if (!slab->free_objects)
+		TAILQ_INSERT_HEAD(&cache->partial_slabs, slab, next);
+
+	test_and_clear_allocated(slab, object_index(slab, object));
+
+	*(void **)object   = slab->free_objects;
+	slab->free_objects = object;
+	slab->nb_used--;
+
+	/* Keep one slab around to avoid bouncing pages with the buddy
+	 * allocator on alloc/free sequences */
+	if (slab->nb_used == 0
+		&& (TAILQ_FIRST(&cache->partial_slabs) != slab
+			|| TAILQ_NEXT(slab, next) != NULL))
+		slab_destroy(slab);
+}
+
+size_t slab_get_object_size(void *owner)
+{
+	return ((struct slab *)owner)->cache->object_size;
+}
+
+void slab_claim_object(void *object, void *owner)
+{
+	struct slab *slab = owner;
+
+	set_allocated(slab, object_index(slab, object));
+}
+
+ret_t slab_release_object(void *object, void *owner)
+{
+	struct slab *slab = owner;
+	int index = object_index(slab, object);
+
+	if (index < 0 || !test_and_clear_allocated(slab, index))
+		return -KERNEL_INVALID_VALUE;
+
+	return KERNEL_OK;
+}
@@ -0,0 +1,80 @@
+#ifndef _SLAB_H_
+#define _SLAB_H_
+
+/**
+ * @file slab.h
+ * @license MIT License
+ *
+ * Size-class caches for small kernel objects.
+ *
+ * Each cache hands out objects of one power of 2 size, from 16 bytes to
+ * 2 KiB, carved in slabs of pages taken from the buddy allocator. A slab
+ * keeps its free objects in a list threaded through the objects and
+ * every page of a slab points back to it, so that allocation and
+ * release are O(1) without any per-object header. A bit per object
+ * tells whether it is handed out, to catch double frees.
+ */
+
+#include <lib/types.h>
+#include <lib/status.h>
+
+#define SLAB_MIN_SIZE  16
+#define SLAB_MAX_SIZE  2048
+
+/** One cache per power of 2 between SLAB_MIN_SIZE and SLAB_MAX_SIZE */
+#define SLAB_NB_CACHES 8
+
+struct spinlock;
+
+/**
+ * Held around the calls to the slab caches and to the buddy allocator
+ * under them, which all the threads share. The per-object calls of the
+ * magazines' fast path don't need it.
+ */
+extern struct spinlock heap_lock;
+
+/** Setup the empty caches */
+void slab_setup(void);
+
+/**
+ * Allocate a small object
+ *
+ * @param size Number of bytes, at most SLAB_MAX_SIZE
+ * @return The object or NULL if no memory is left
+ */
+void *slab_alloc(size_t size);
+
+/**
+ * Release an object allocated by slab_alloc()
+ *
+ * @param object The object
+ * @param owner The page frame owner of the object, @see buddy.h
+ */
+void slab_free(void *object, void *owner);
+
+/**
+ * Mark an object taken from a per-thread cache as handed out
+ *
+ * @param object The object
+ * @param owner The page frame owner of the object, @see buddy.h
+ */
+void slab_claim_object(void *object, void *owner);
+
+/**
+ * Mark an object as given back, before it is cached or freed
+ *
+ * @param object The object
+ * @param owner The page frame owner of the object, @see buddy.h
+ * @return KERNEL_OK or -KERNEL_INVALID_VALUE if the object is already
+ * free (double free) or the address is not an object of the slab
+ */
+ret_t slab_release_object(void *object, void *owner);
+
+/**
+ * Size of the objects of a slab
+ *
+ * @param owner The page frame owner of an object, @see buddy.h
+ */
+size_t slab_get_object_size(void *owner);
+
+#endif // _SLAB_H_
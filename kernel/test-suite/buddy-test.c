@@ -0,0 +1,111 @@
+#include <lib/types.h>
+#include <lib/libc.h>
+#include <memory/physical-memory.h>
+#include <memory/buddy.h>
+#include <arch/x86-pc/timer/clock.h>
+
+#include "buddy-test.h"
+
+#define NB_SLOTS	64
+#define NB_ROUNDS	20000
+#define MAX_TEST_ORDER	4
+
+static void *slots[NB_SLOTS];
+static uint32_t slot_orders[NB_SLOTS];
+
+/* Linear congruential generator, good enough to shuffle requests */
+static uint32_t random(void)
+{
+	static uint32_t seed = 42;
+
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+/* 100 - percentage of the free memory held by the largest block */
+static uint32_t fragmentation(void)
+{
+	uint32_t free_pages = buddy_get_free_pages();
+	int order = buddy_get_largest_free_order();
+
+	if (free_pages == 0 || order < 0)
+		return 0;
+
+	return 100 - ((100 << order) / free_pages);
+}
+
+void test_buddy_allocator(void)
+{
+	uint32_t initial_free_pages = buddy_get_free_pages();
+	uint64_t alloc_ns = 0, free_ns = 0, start;
+	uint32_t nb_allocs = 0, nb_frees = 0, nb_failures = 0;
+	uint32_t worst_fragmentation = 0;
+	uint32_t i, round;
+
+	printf("\n\n++ Buddy allocator stress test! ++\n");
+
+	for (round = 0; round < NB_ROUNDS; round++)
+	{
+		i = random() % NB_SLOTS;
+
+		if (slots[i])
+		{
+			// Check that nobody overwrote the block
+			assert(*(uint32_t *)slots[i] == (uint32_t)slots[i]);
+
+			start = clock_now_ns();
+			assert(buddy_free(slots[i]) == KERNEL_OK);
+			free_ns += clock_now_ns() - start;
+
+			// A second release must be refused
+			assert(buddy_free(slots[i]) != KERNEL_OK);
+
+			slots[i] = NULL;
+			nb_frees++;
+		}
+		else
+		{
+			slot_orders[i] = random() % (MAX_TEST_ORDER + 1);
+
+			start = clock_now_ns();
+			slots[i] = buddy_alloc(slot_orders[i]);
+			alloc_ns += clock_now_ns() - start;
+
+			if (!slots[i])
+			{
+				nb_failures++;
+				continue;
+			}
+
+			assert(IS_PAGE_ALIGNED(slots[i]));
+			assert(((uint32_t)slots[i] & ((X86_PAGE_SIZE << slot_orders[i]) - 1)) == 0);
+
+			*(uint32_t *)slots[i] = (uint32_t)slots[i];
+			nb_allocs++;
+		}
+
+		if (fragmentation() > worst_fragmentation)
+			worst_fragmentation = fragmentation();
+	}
+
+	printf("Fragmentation: %d%% now, %d%% at worst\n",
+		fragmentation(), worst_fragmentation);
+
+	for (i = 0; i < NB_SLOTS; i++)
+	{
+		if (slots[i])
+		{
+			assert(buddy_free(slots[i]) == KERNEL_OK);
+			slots[i] = NULL;
+		}
+	}
+
+	// Everything must have been merged back
+	assert(buddy_get_free_pages() == initial_free_pages);
+
+	printf("%d allocations (%d failed), %d releases\n",
+		nb_allocs, nb_failures, nb_frees);
+	printf("ns per allocation: %d, per release: %d\n",
+		(uint32_t)alloc_ns / (nb_allocs + nb_failures),
+		(uint32_t)free_ns / nb_frees);
+}
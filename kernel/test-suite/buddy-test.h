@@ -0,0 +1,13 @@
+#ifndef _BUDDY_TEST_H_
+#define _BUDDY_TEST_H_
+
+/**
+ * @file buddy-test.h
+ * @license MIT License
+ *
+ * Buddy allocator stress testing
+ */
+
+void test_buddy_allocator(void);
+
+#endif // _BUDDY_TEST_H_
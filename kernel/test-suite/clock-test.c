@@ -0,0 +1,50 @@
+#include <lib/libc.h>
+#include <arch/x86-pc/timer/pit.h>
+#include <arch/x86-pc/timer/clock.h>
+
+#include "clock-test.h"
+
+#define NB_READS  1000
+#define NB_TICKS  20
+
+void test_clock(void)
+{
+	uint64_t previous, now, start, read_ns;
+	uint32_t i, tick, elapsed_us;
+
+	printf("\n\n++ Clock test! ++\n");
+
+	// Monotonic, the reads time themselves
+	previous = start = clock_now_ns();
+
+	for (i = 0; i < NB_READS; i++)
+	{
+		now = clock_now_ns();
+		assert(now >= previous);
+		previous = now;
+	}
+	read_ns = previous - start;
+
+	// Agrees with the ticks within one tick, the interrupts must be
+	// enabled
+	tick = timer_get_ticks();
+	while (timer_get_ticks() == tick)
+		;
+
+	tick  = timer_get_ticks();
+	start = clock_now_ns();
+
+	while (timer_get_ticks() - tick < NB_TICKS)
+		;
+
+	elapsed_us = (uint32_t)udiv64(clock_now_ns() - start, 1000, NULL);
+
+	assert(elapsed_us + 1000000 / TIMER_FREQUENCY
+		>= NB_TICKS * (1000000 / TIMER_FREQUENCY));
+	assert(elapsed_us
+		<= (NB_TICKS + 1) * (1000000 / TIMER_FREQUENCY));
+
+	printf("TSC: %d kHz, clock_now_ns(): %d ns, %d ticks in %d us\n",
+		clock_get_tsc_khz(), (uint32_t)read_ns / NB_READS,
+		NB_TICKS, elapsed_us);
+}
@@ -0,0 +1,13 @@
+#ifndef _CLOCK_TEST_H_
+#define _CLOCK_TEST_H_
+
+/**
+ * @file clock-test.h
+ * @license MIT License
+ *
+ * Monotonic nanosecond clock against the timer ticks
+ */
+
+void test_clock(void);
+
+#endif // _CLOCK_TEST_H_
@@ -0,0 +1,88 @@
+#include <lib/libc.h>
+#include <arch/x86-pc/timer/clock.h>
+#include <threading/thread.h>
+#include <threading/scheduler.h>
+#include <threading/semaphore.h>
+
+#include "context-switch-test.h"
+
+#define NB_ROUNDS 10000
+
+/* Above the other threads, so that the measure only counts the two */
+#define BENCHMARK_PRIORITY (THREAD_PRIORITY_MAX - 1)
+
+static struct semaphore ping_turn;
+static struct semaphore pong_turn;
+static struct semaphore finished;
+
+static volatile uint32_t pong_rounds;
+
+static void pong(void *arg)
+{
+	uint32_t i;
+
+	(void)arg;
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		semaphore_down(&pong_turn);
+		pong_rounds++;
+		semaphore_up(&ping_turn);
+	}
+
+	semaphore_up(&finished);
+}
+
+/* Each round blocks both threads once: two switches */
+static void ping(void *arg)
+{
+	uint64_t start_ns, elapsed_ns;
+	uint32_t i, remainder, elapsed_us, switches_per_second;
+	struct thread *thr;
+
+	(void)arg;
+
+	semaphore_init(&ping_turn, 0);
+	semaphore_init(&pong_turn, 0);
+	semaphore_init(&finished, 0);
+	pong_rounds = 0;
+
+	thr = thread_create("pong", pong, NULL);
+	assert(thr != NULL);
+	scheduler_set_priority(thr, BENCHMARK_PRIORITY);
+
+	start_ns = clock_now_ns();
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		semaphore_up(&pong_turn);
+		semaphore_down(&ping_turn);
+	}
+
+	elapsed_ns = clock_now_ns() - start_ns;
+	elapsed_us = (uint32_t)udiv64(elapsed_ns, 1000, &remainder);
+
+	semaphore_down(&finished);
+	assert(pong_rounds == NB_ROUNDS);
+
+	if (!elapsed_us)
+		elapsed_us = 1;
+
+	switches_per_second = (uint32_t)udiv64(2ULL * NB_ROUNDS * 1000000ULL,
+					elapsed_us, &remainder);
+
+	printf("Context switch: %d switches/s, %d ns per switch\n",
+		switches_per_second,
+		(uint32_t)udiv64(elapsed_ns, 2 * NB_ROUNDS, &remainder));
+}
+
+void test_context_switch(void)
+{
+	struct thread *thr;
+
+	printf("\n\n++ Context switch test! ++\n");
+
+	thr = thread_create("ping", ping, NULL);
+	assert(thr != NULL);
+	scheduler_set_priority(thr, BENCHMARK_PRIORITY);
+}
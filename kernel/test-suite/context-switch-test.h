@@ -0,0 +1,13 @@
+#ifndef _CONTEXT_SWITCH_TEST_H_
+#define _CONTEXT_SWITCH_TEST_H_
+
+/**
+ * @file context-switch-test.h
+ * @license MIT License
+ *
+ * Ping-pong between two threads, measuring the context switches per second
+ */
+
+void test_context_switch(void);
+
+#endif // _CONTEXT_SWITCH_TEST_H_
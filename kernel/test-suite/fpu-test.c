@@ -0,0 +1,167 @@
+#include <lib/libc.h>
+#include <arch/x86/mmu/paging.h>
+#include <arch/x86/threading/fpu.h>
+#include <threading/thread.h>
+#include <threading/semaphore.h>
+
+#include "fpu-test.h"
+
+#define NB_ROUNDS 100
+
+/* x87 control word: all exceptions masked, double extended precision,
+ * and the rounding control */
+#define CW_ROUND_DOWN 0x077F
+#define CW_ROUND_UP   0x0B7F
+
+static struct semaphore up_turn;
+static struct semaphore down_turn;
+static struct semaphore integer_turn;
+static struct semaphore finished;
+
+static uint16_t read_cw(void)
+{
+	uint16_t cw;
+
+	asm volatile("fnstcw %0" : "=m"(cw));
+	return cw;
+}
+
+static void write_cw(uint16_t cw)
+{
+	asm volatile("fldcw %0" :: "m"(cw));
+}
+
+/* Converted with the rounding mode of the thread */
+static int32_t round_x87(const double *value)
+{
+	int32_t result;
+
+	asm volatile("fldl %1\n"
+		"fistpl %0" : "=m"(result) : "m"(*value));
+	return result;
+}
+
+/* Alternates with the other thread using the FPU, each switch faults */
+static void rounding_thread(void *arg)
+{
+	bool_t up = (arg != NULL);
+	const double half = 2.5;
+	uint32_t i;
+
+	write_cw(up ? CW_ROUND_UP : CW_ROUND_DOWN);
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		if (up)
+		{
+			semaphore_up(&down_turn);
+			semaphore_down(&up_turn);
+		}
+		else
+		{
+			semaphore_down(&down_turn);
+			semaphore_up(&up_turn);
+		}
+
+		assert(read_cw() == (up ? CW_ROUND_UP : CW_ROUND_DOWN));
+		assert(round_x87(&half) == (up ? 3 : 2));
+	}
+
+	semaphore_up(&finished);
+}
+
+/* Deeper than the committed top page of a new thread's stack */
+static uint32_t touch_stack(void)
+{
+	volatile uint8_t area[3 * X86_PAGE_SIZE];
+	uint32_t i, sum = 0;
+
+	for (i = 0; i < sizeof(area); i += X86_PAGE_SIZE)
+		area[i] = 1;
+
+	for (i = 0; i < sizeof(area); i += X86_PAGE_SIZE)
+		sum += area[i];
+
+	return sum;
+}
+
+/* The page fault task switches set CR0.TS while the thread owns the FPU */
+static void stack_fault_thread(void *arg)
+{
+	const double half = 2.5;
+
+	(void)arg;
+
+	write_cw(CW_ROUND_UP);
+	assert(round_x87(&half) == 3);
+
+	assert(touch_stack() == 3);
+
+	assert(read_cw() == CW_ROUND_UP);
+	assert(round_x87(&half) == 3);
+
+	semaphore_up(&finished);
+}
+
+static void integer_thread(void *arg)
+{
+	uint32_t i;
+
+	(void)arg;
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		semaphore_down(&integer_turn);
+		semaphore_up(&up_turn);
+	}
+}
+
+static void fpu_controller(void *arg)
+{
+	const double half = 2.5;
+	uint32_t i, faults;
+
+	(void)arg;
+
+	semaphore_init(&up_turn, 0);
+	semaphore_init(&down_turn, 0);
+	semaphore_init(&integer_turn, 0);
+	semaphore_init(&finished, 0);
+
+	assert(thread_create("round up", rounding_thread, (void *)1) != NULL);
+	assert(thread_create("round down", rounding_thread, NULL) != NULL);
+
+	semaphore_down(&finished);
+	semaphore_down(&finished);
+
+	assert(thread_create("fpu stack fault", stack_fault_thread, NULL) != NULL);
+	semaphore_down(&finished);
+
+	// Switching with a thread which never uses the FPU costs nothing:
+	// the registers stay loaded, no save, no restore, no fault
+	write_cw(CW_ROUND_UP);
+	round_x87(&half);
+
+	assert(thread_create("integer", integer_thread, NULL) != NULL);
+	faults = x86_fpu_get_nb_faults();
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		semaphore_up(&integer_turn);
+		semaphore_down(&up_turn);
+
+		assert(round_x87(&half) == 3);
+	}
+
+	assert(x86_fpu_get_nb_faults() == faults);
+
+	printf("FPU: rounding modes kept over %d switches and a stack fault, "
+		"no fault with an integer thread\n", 2 * NB_ROUNDS);
+}
+
+void test_fpu(void)
+{
+	printf("\n\n++ FPU test! ++\n");
+
+	assert(thread_create("fpu controller", fpu_controller, NULL) != NULL);
+}
@@ -0,0 +1,13 @@
+#ifndef _FPU_TEST_H_
+#define _FPU_TEST_H_
+
+/**
+ * @file fpu-test.h
+ * @license MIT License
+ *
+ * FPU registers of each thread kept across the switches, switched lazily
+ */
+
+void test_fpu(void);
+
+#endif // _FPU_TEST_H_
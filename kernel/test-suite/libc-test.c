@@ -0,0 +1,119 @@
+#include <lib/types.h>
+#include <lib/libc.h>
+#include <arch/x86-pc/timer/clock.h>
+
+#include "libc-test.h"
+
+#define MAX_LENGTH	64
+#define ALIGNMENTS	4
+#define SPEED_LENGTH	1024
+#define SPEED_ROUNDS	1000
+
+static char area1[MAX_LENGTH + 2 * ALIGNMENTS];
+static char area2[MAX_LENGTH + 2 * ALIGNMENTS];
+static char long_string[SPEED_LENGTH + 1];
+
+/* Byte per byte references */
+static size_t reference_strlen(const char *s)
+{
+	size_t length = 0;
+
+	while (s[length])
+		length++;
+
+	return length;
+}
+
+static int sign(int value)
+{
+	return (value > 0) - (value < 0);
+}
+
+static void fill(char *s, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		s[i] = 'a' + (i % 26);
+
+	s[length] = '\0';
+}
+
+static void test_correctness(void)
+{
+	const char *code_letters = " rtoe";
+	uint32_t align1, align2;
+	size_t length, i;
+
+	for (align1 = 0; align1 < ALIGNMENTS; align1++)
+	for (align2 = 0; align2 < ALIGNMENTS; align2++)
+	for (length = 0; length < MAX_LENGTH; length++)
+	{
+		char *s1 = area1 + align1;
+		char *s2 = area2 + align2;
+
+		fill(s1, length);
+		fill(s2, length);
+
+		assert(strlen(s1) == length);
+		assert(strcmp(s1, s2) == 0);
+		assert(strncmp(s1, s2, length + 1) == 0);
+		assert(memcmp(s1, s2, length) == 0);
+
+		/* The terminator is part of the string */
+		assert(strchr(s1, '\0') == s1 + length);
+		assert(strchr(s1, '#') == NULL);
+
+		for (i = 0; i < length; i++)
+		{
+			assert(strchr(s1, s1[i]) == s1 + (i % 26));
+
+			s2[i] = 'z' + 1;
+			assert(sign(strcmp(s1, s2)) == -1);
+			assert(sign(strncmp(s2, s1, length)) == 1);
+			assert(strncmp(s1, s2, i) == 0);
+			assert(sign(memcmp(s1, s2, length)) == -1);
+			assert(memcmp(s1, s2, i) == 0);
+			s2[i] = s1[i];
+		}
+	}
+
+	/* get_code_index(' ') in the editor relies on the first character */
+	assert(strchr(code_letters, ' ') == code_letters);
+	assert(strchr(code_letters, '\0') == code_letters + 5);
+}
+
+static void test_speed(void)
+{
+	uint64_t start, bytewise, wordwise;
+	uint32_t i;
+	volatile size_t length = 0;
+
+	fill(long_string, SPEED_LENGTH);
+
+	start = clock_now_ns();
+	for (i = 0; i < SPEED_ROUNDS; i++)
+		length += reference_strlen(long_string);
+	bytewise = clock_now_ns() - start;
+
+	start = clock_now_ns();
+	for (i = 0; i < SPEED_ROUNDS; i++)
+		length += strlen(long_string);
+	wordwise = clock_now_ns() - start;
+
+	assert(length == 2 * SPEED_ROUNDS * SPEED_LENGTH);
+
+	printf("strlen: %d ns/KiB (bytewise: %d ns/KiB)\n",
+		(uint32_t)wordwise / SPEED_ROUNDS,
+		(uint32_t)bytewise / SPEED_ROUNDS);
+}
+
+void test_libc(void)
+{
+	printf("\n\n++ libc string functions test! ++\n");
+
+	test_correctness();
+	test_speed();
+
+	printf("libc string functions: OK\n");
+}
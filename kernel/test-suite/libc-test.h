@@ -0,0 +1,13 @@
+#ifndef _LIBC_TEST_H_
+#define _LIBC_TEST_H_
+
+/**
+ * @file libc-test.h
+ * @license MIT License
+ *
+ * String functions correctness and speed testing
+ */
+
+void test_libc(void);
+
+#endif // _LIBC_TEST_H_
@@ -0,0 +1,103 @@
+#include <lib/types.h>
+#include <lib/libc.h>
+#include <lib/status.h>
+#include <arch/x86/interrupts/irq.h>
+#include <arch/x86/mmu/paging.h>
+#include <arch/x86-pc/timer/clock.h>
+#include <memory/physical-memory.h>
+
+#include "paging-test.h"
+
+#define NB_PAGES	(X86_PAGING_LARGE_SIZE / X86_PAGE_SIZE)
+#define NB_ROUNDS	64
+
+#define CR0_PG		0x80000000
+
+/* Touch one word per page, the TLB can't hold 4 MiB of 4 KiB pages.
+ * Returns the picoseconds per page, a touch taking a few ns. */
+static uint32_t walk_pages(uint32_t *block)
+{
+	volatile uint32_t sum = 0;
+	uint64_t start;
+	uint32_t round, page;
+
+	start = clock_now_ns();
+
+	for (round = 0; round < NB_ROUNDS; round++)
+		for (page = 0; page < NB_PAGES; page++)
+			sum += block[page * (X86_PAGE_SIZE / sizeof(uint32_t))];
+
+	return (uint32_t)udiv64((clock_now_ns() - start) * 1000,
+		NB_ROUNDS * NB_PAGES, NULL);
+}
+
+/* The RAM is identity mapped, so paging can be briefly turned off */
+static uint32_t walk_pages_unpaged(uint32_t *block)
+{
+	uint32_t flags, cr0, ps;
+
+	X86_IRQs_DISABLE(flags);
+
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	asm volatile("movl %0, %%cr0" :: "r"(cr0 & ~CR0_PG) : "memory");
+
+	ps = walk_pages(block);
+
+	asm volatile("movl %0, %%cr0" :: "r"(cr0) : "memory");
+
+	X86_IRQs_ENABLE(flags);
+
+	return ps;
+}
+
+void test_paging(void)
+{
+	uint32_t *block;
+	uint32_t unpaged, large, small;
+	uint32_t page;
+
+	printf("\n\n++ Paging test! ++\n");
+
+	// A block of the buddy allocator is aligned on its size
+	block = heap_alloc(X86_PAGING_LARGE_SIZE);
+
+	if (!block)
+	{
+		printf("Not enough memory for a 4 MiB block\n");
+		return;
+	}
+
+	// Identity mapping
+	assert(x86_paging_get_physical((vaddr_t)block) == (paddr_t)block);
+	assert(x86_paging_get_physical((vaddr_t)block + 0x12345)
+		== (paddr_t)block + 0x12345);
+
+	for (page = 0; page < NB_PAGES; page++)
+		block[page * (X86_PAGE_SIZE / sizeof(uint32_t))] = page;
+
+	unpaged = walk_pages_unpaged(block);
+	large   = walk_pages(block);
+
+	// Remap the block with 4 KiB pages
+	for (page = 0; page < NB_PAGES; page++)
+	{
+		vaddr_t address = (vaddr_t)block + page * X86_PAGE_SIZE;
+
+		assert(x86_paging_map(address, address,
+				X86_PAGING_WRITABLE | X86_PAGING_GLOBAL) == KERNEL_OK);
+	}
+
+	small = walk_pages(block);
+
+	for (page = 0; page < NB_PAGES; page++)
+		assert(block[page * (X86_PAGE_SIZE / sizeof(uint32_t))] == page);
+
+	// Back to a single 4 MiB page, unless PSE isn't available
+	x86_paging_map_large((vaddr_t)block, (paddr_t)block,
+		X86_PAGING_WRITABLE | X86_PAGING_GLOBAL);
+
+	heap_free(block);
+
+	printf("ps per page touched: %d unpaged, %d with 4 MiB pages, "
+		"%d with 4 KiB pages\n", unpaged, large, small);
+}
@@ -0,0 +1,13 @@
+#ifndef _PAGING_TEST_H_
+#define _PAGING_TEST_H_
+
+/**
+ * @file paging-test.h
+ * @license MIT License
+ *
+ * Paging testing, and TLB misses cost with 4 KiB and 4 MiB pages
+ */
+
+void test_paging(void);
+
+#endif // _PAGING_TEST_H_
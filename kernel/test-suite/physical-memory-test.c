@@ -1,7 +1,9 @@
 #include <lib/types.h>
 #include <lib/libc.h>
+#include <lib/status.h>
 #include <lib/queue.h>
 #include <arch/x86-pc/io/vga.h>
+#include <arch/x86-pc/timer/clock.h>
 #include <memory/physical-memory.h>
 
 #include "physical-memory-test.h"
@@ -15,7 +17,6 @@ struct phys_page
         uint32_t after[MY_PPAGE_NUM_INT];
 };
 
-
 void test_physical_memory(void)
 {
         TAILQ_HEAD(, phys_page) phys_pages_head;
@@ -24,31 +25,40 @@ void test_physical_memory(void)
 
         uint32_t nb_allocated_physical_pages = 0;
 	uint32_t nb_free_physical_pages = 0;
+	uint32_t alloc_us, free_us;
+	uint64_t start, alloc_ns, free_ns = 0;
 
         TAILQ_INIT(&phys_pages_head);
 
         printf("\n\n++ Physical memory allocaion/deallocation test! ++\n");
 
-	// Test the allocation
+	// Test the allocation, of the whole RAM
+	start = clock_now_ns();
+
         while ((phys_page = (struct phys_page*)physical_memory_page_reference_new()) != NULL)
         {
-                int i;
                 nb_allocated_physical_pages++;
+                TAILQ_INSERT_TAIL(&phys_pages_head, phys_page, next);
+        }
 
-                vga_set_position(0, 7);
-                printf("Can allocate %d pages\n", nb_allocated_physical_pages);
+	alloc_ns = clock_now_ns() - start;
 
-                for (i = 0 ; i < MY_PPAGE_NUM_INT ; i++)
+	vga_set_position(0, 7);
+	printf("Can allocate %d pages\n", nb_allocated_physical_pages);
+
+	TAILQ_FOREACH(phys_page, &phys_pages_head, next)
+	{
+		int i;
+
+		for (i = 0 ; i < MY_PPAGE_NUM_INT ; i++)
 		{
-                        phys_page->before[i] = (uint32_t)phys_page;
+			phys_page->before[i] = (uint32_t)phys_page;
 			phys_page->after[i]  = (uint32_t)phys_page;
 		}
-
-                TAILQ_INSERT_TAIL(&phys_pages_head, phys_page, next);
-        }
+	}
 
 	// Test the deallocation
-	TAILQ_FOREACH(phys_page, &phys_pages_head, next)
+	while ((phys_page = TAILQ_FIRST(&phys_pages_head)) != NULL)
         {
                 int i;
 
@@ -62,21 +72,47 @@ void test_physical_memory(void)
                         }
                 }
 
+		// The link lives in the page, don't touch it once freed
+		TAILQ_REMOVE(&phys_pages_head, phys_page, next);
+
+		start = clock_now_ns();
+
                 if (physical_memory_page_unreference((uint32_t)phys_page) < 0)
                 {
                         printf("Cannot dealloc page\n");
                         return;
                 }
 
-                nb_free_physical_pages++;
+		free_ns += clock_now_ns() - start;
 
-                vga_set_position(30, 7);
-                printf("Can free %d pages\n", nb_free_physical_pages);
+                nb_free_physical_pages++;
         }
 
+	vga_set_position(30, 7);
+	printf("Can free %d pages\n", nb_free_physical_pages);
+
         assert(nb_allocated_physical_pages == nb_free_physical_pages);
 
+	// A page can't be freed twice
+	phys_page = physical_memory_page_reference_new();
+	assert(phys_page != NULL);
+	assert(physical_memory_page_unreference((uint32_t)phys_page) == KERNEL_OK);
+	assert(physical_memory_page_unreference((uint32_t)phys_page) < 0);
+
+	// Nor given to heap_free(): it is reported and left to the pool
+	phys_page = physical_memory_page_reference_new();
+	assert(phys_page != NULL);
+	heap_free(phys_page);
+	assert(physical_memory_page_unreference((uint32_t)phys_page) == KERNEL_OK);
+
 	printf("Can allocate %d bytes and free %d bytes \n", 
 		nb_allocated_physical_pages << X86_PAGE_SHIFT,
 		nb_free_physical_pages << X86_PAGE_SHIFT);
+
+	alloc_us = (uint32_t)udiv64(alloc_ns, 1000, NULL) + 1;
+	free_us  = (uint32_t)udiv64(free_ns, 1000, NULL) + 1;
+
+	printf("Allocation: %d pages/s, release: %d pages/s\n",
+		nb_allocated_physical_pages * 1000 / alloc_us * 1000,
+		nb_free_physical_pages * 1000 / free_us * 1000);
 }
@@ -0,0 +1,183 @@
+#include <lib/libc.h>
+#include <lib/status.h>
+#include <arch/x86/interrupts/irq.h>
+#include <arch/x86-pc/timer/clock.h>
+#include <arch/x86-pc/timer/pit.h>
+#include <threading/thread.h>
+#include <threading/scheduler.h>
+#include <threading/timer.h>
+#include <threading/wait-queue.h>
+
+#include "scheduler-test.h"
+
+#define NB_SAMPLES 50
+#define NB_JOBS    20
+#define NB_SLEEPS  10
+
+static struct wait_queue wake_up;
+static struct timer wake_up_timer;
+static volatile bool_t done;
+
+/* Set by the timer interrupt when it wakes the high priority thread */
+static volatile uint64_t wake_up_ns;
+static volatile uint32_t wake_up_tick;
+
+/* Wake the high priority thread up from the timer interrupt */
+static void wake_up_high(void *arg)
+{
+	(void)arg;
+
+	wake_up_tick = timer_get_ticks();
+	wake_up_ns   = clock_now_ns();
+	wait_queue_wake_one(&wake_up);
+}
+
+static void high_priority_thread(void *arg)
+{
+	uint32_t i, flags, latency, max_latency = 0, late = 0;
+	uint64_t total = 0;
+
+	(void)arg;
+
+	for (i = 0; i < NB_SAMPLES; i++)
+	{
+		// Armed with IRQs disabled, it can't expire before the sleep
+		X86_IRQs_DISABLE(flags);
+		timer_arm_ticks(&wake_up_timer, 1, 0);
+		wait_queue_sleep(&wake_up);
+		X86_IRQs_ENABLE(flags);
+
+		latency = (uint32_t)(clock_now_ns() - wake_up_ns);
+		total  += latency;
+
+		if (latency > max_latency)
+			max_latency = latency;
+
+		// Preempted before the timer interrupt handler even returned
+		if (timer_get_ticks() != wake_up_tick)
+			late++;
+	}
+
+	done = TRUE;
+
+	printf("Wake up latency: %d ns on average, %d at worst, "
+		"%d/%d after the tick\n",
+		(uint32_t)udiv64(total, NB_SAMPLES, NULL), max_latency,
+		late, NB_SAMPLES);
+
+	assert(late == 0);
+}
+
+/* Stands for the editor: a default priority thread always ready */
+static void busy_thread(void *arg)
+{
+	(void)arg;
+
+	while (!done)
+		;
+}
+
+void test_scheduler_latency(void)
+{
+	struct thread *high;
+
+	printf("\n\n++ Scheduler latency test! ++\n");
+
+	wait_queue_init(&wake_up);
+	timer_init(&wake_up_timer, wake_up_high, NULL, TIMER_IRQ);
+	done = FALSE;
+
+	high = thread_create("high", high_priority_thread, NULL);
+	assert(high != NULL);
+	scheduler_set_priority(high, THREAD_PRIORITY_MAX);
+
+	// Last, it won't give the CPU back to a lower priority caller
+	assert(thread_create("busy", busy_thread, NULL) != NULL);
+}
+
+/* Completes each of its jobs well within its budget */
+static void periodic_thread(void *arg)
+{
+	struct thread *self = thread_get_current();
+	struct thread *hog  = arg;
+	uint32_t i;
+
+	assert(scheduler_set_edf(self, 10, 3, 10) == KERNEL_OK);
+
+	for (i = 0; i < NB_JOBS; i++)
+		scheduler_edf_wait_next_period();
+
+	// The hog is throttled, but never delays the other EDF thread
+	assert(self->edf.deadline_misses == 0);
+	assert(hog->edf.budget_overruns > 0);
+
+	// 0.4 for the hog: no room left for a full CPU
+	assert(scheduler_set_edf(self, 10, 10, 10) == -KERNEL_BUSY);
+	assert(scheduler_set_edf(self, 10, 6, 5) == -KERNEL_INVALID_VALUE);
+	assert(self->edf.budget == 3);
+
+	printf("EDF: %d jobs, %d misses, hog: %d overruns, %d misses\n",
+		NB_JOBS, self->edf.deadline_misses,
+		hog->edf.budget_overruns, hog->edf.deadline_misses);
+
+	scheduler_set_priority(self, THREAD_PRIORITY_DEFAULT);
+	done = TRUE;
+}
+
+/* Never completes a job, it runs until its budget is exhausted */
+static void hog_thread(void *arg)
+{
+	struct thread *self = thread_get_current();
+
+	(void)arg;
+
+	assert(scheduler_set_edf(self, 10, 2, 5) == KERNEL_OK);
+
+	while (!done)
+		;
+
+	scheduler_set_priority(self, THREAD_PRIORITY_IDLE);
+}
+
+void test_scheduler_edf(void)
+{
+	struct thread *hog;
+
+	printf("\n\n++ Scheduler EDF test! ++\n");
+
+	done = FALSE;
+
+	hog = thread_create("hog", hog_thread, NULL);
+	assert(hog != NULL);
+	assert(thread_create("periodic", periodic_thread, hog) != NULL);
+}
+
+/* Each sleep is a voluntary switch and a wake up */
+static void sleeping_thread(void *arg)
+{
+	struct thread *self = thread_get_current();
+	struct thread_statistics *stats = &self->statistics;
+	uint32_t i, bucket, total = 0;
+
+	(void)arg;
+
+	for (i = 0; i < NB_SLEEPS; i++)
+		thread_sleep(1000000ULL);
+
+	assert(stats->voluntary_switches >= NB_SLEEPS);
+	assert(stats->wake_ups >= NB_SLEEPS);
+
+	for (bucket = 0; bucket < THREAD_LATENCY_BUCKETS; bucket++)
+		total += stats->latency_histogram[bucket];
+
+	assert(total == stats->wake_ups);
+
+	thread_dump_statistics();
+}
+
+void test_scheduler_statistics(void)
+{
+	printf("\n\n++ Scheduler statistics test! ++\n");
+
+	assert(thread_create("sleeping", sleeping_thread, NULL) != NULL);
+}
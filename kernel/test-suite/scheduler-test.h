@@ -0,0 +1,17 @@
+#ifndef _SCHEDULER_TEST_H_
+#define _SCHEDULER_TEST_H_
+
+/**
+ * @file scheduler-test.h
+ * @license MIT License
+ *
+ * Preemption latency of a high priority thread woken up by an interrupt,
+ * EDF budget enforcement and admission control, and the scheduling
+ * statistics
+ */
+
+void test_scheduler_latency(void);
+void test_scheduler_edf(void);
+void test_scheduler_statistics(void);
+
+#endif // _SCHEDULER_TEST_H_
@@ -0,0 +1,100 @@
+#include <lib/libc.h>
+#include <threading/thread.h>
+#include <threading/semaphore.h>
+#include <arch/x86/mmu/paging.h>
+#include <arch/x86-pc/timer/pit.h>
+
+#include "stack-test.h"
+
+/* About 40 KiB of stack, far more than the committed top page */
+#define FRAME_SIZE	512
+#define DEPTH		80
+
+/* Together they fault in more pages than set aside for the handler,
+ * which is refilled once it runs low */
+#define NB_GROWERS	5
+
+/* The threads grow their stacks one at a time */
+static struct semaphore grow_turn;
+static struct semaphore all_grown;
+static uint32_t nb_grown;
+
+static uint32_t deep_recursion(uint32_t depth)
+{
+	volatile uint8_t frame[FRAME_SIZE];
+	uint32_t i;
+
+	for (i = 0; i < FRAME_SIZE; i++)
+		frame[i] = depth;
+
+	if (depth == 0)
+		return frame[0];
+
+	return frame[FRAME_SIZE - 1] + deep_recursion(depth - 1);
+}
+
+static void grow_stack(void *arg)
+{
+	struct thread *current = thread_get_current();
+	uint32_t committed = 0;
+	vaddr_t page;
+
+	(void)arg;
+
+	assert(deep_recursion(DEPTH) == DEPTH * (DEPTH + 1) / 2);
+
+	for (page = current->stack_base_address;
+		page < current->stack_base_address + current->stack_size;
+		page += X86_PAGE_SIZE)
+	{
+		if (x86_paging_get_physical(page))
+			committed++;
+	}
+
+	printf("Stack: %d KiB committed out of %d KiB\n",
+		committed * X86_PAGE_SIZE / 1024,
+		current->stack_size / 1024);
+
+	semaphore_up(&grow_turn);
+}
+
+/* Grows its stack in turn, still holding its pages when the next does */
+static void grow_later(void *arg)
+{
+	uint32_t i;
+
+	(void)arg;
+
+	semaphore_down(&grow_turn);
+
+	// The refill asked for by the previous faults is one tick away
+	thread_sleep(TIMER_NS_PER_TICK);
+	assert(deep_recursion(DEPTH) == DEPTH * (DEPTH + 1) / 2);
+
+	if (++nb_grown == NB_GROWERS)
+	{
+		for (i = 1; i < NB_GROWERS; i++)
+			semaphore_up(&all_grown);
+	}
+	else
+	{
+		semaphore_up(&grow_turn);
+		semaphore_down(&all_grown);
+	}
+}
+
+void test_kernel_stacks(void)
+{
+	uint32_t i;
+
+	printf("\n\n++ Kernel stacks test! ++\n");
+
+	semaphore_init(&grow_turn, 0);
+	semaphore_init(&all_grown, 0);
+	nb_grown = 0;
+
+	assert(thread_create("stack", grow_stack, NULL) != NULL);
+
+	for (i = 0; i < NB_GROWERS; i++)
+		assert(thread_create("stack grower", grow_later, NULL) != NULL);
+}
@@ -0,0 +1,13 @@
+#ifndef _STACK_TEST_H_
+#define _STACK_TEST_H_
+
+/**
+ * @file stack-test.h
+ * @license MIT License
+ *
+ * Kernel threads' stacks growing on demand
+ */
+
+void test_kernel_stacks(void);
+
+#endif // _STACK_TEST_H_
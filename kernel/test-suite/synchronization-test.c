@@ -0,0 +1,202 @@
+#include <lib/libc.h>
+#include <threading/thread.h>
+#include <threading/scheduler.h>
+#include <threading/mutex.h>
+#include <threading/semaphore.h>
+#include <threading/spinlock.h>
+
+#include "synchronization-test.h"
+
+#define NB_WORKERS   4
+#define NB_ROUNDS    10
+#define NB_UNITS     8
+
+#define LOW_PRIORITY     5
+#define MEDIUM_PRIORITY  10
+#define HIGH_PRIORITY    20
+#define CONTROL_PRIORITY 25
+
+static struct mutex counter_lock;
+static volatile uint32_t counter;
+
+static struct semaphore workers_done;
+static struct semaphore units;
+
+static volatile bool_t urgent_ran;
+
+static struct mutex inherited;
+static volatile bool_t low_locked;
+static volatile bool_t high_waiting;
+static volatile bool_t high_done;
+static volatile uint32_t boosted_priority;
+static struct semaphore high_finished;
+
+/* Sleeps in the critical section, so that the others run meanwhile */
+static void worker(void *arg)
+{
+	uint32_t i, value;
+
+	(void)arg;
+
+	for (i = 0; i < NB_ROUNDS; i++)
+	{
+		mutex_lock(&counter_lock);
+
+		value = counter;
+		thread_sleep(1000000ULL);
+		counter = value + 1;
+
+		mutex_unlock(&counter_lock);
+	}
+
+	semaphore_up(&workers_done);
+}
+
+static void producer(void *arg)
+{
+	uint32_t i;
+
+	(void)arg;
+
+	for (i = 0; i < NB_UNITS; i++)
+	{
+		thread_sleep(1000000ULL);
+		semaphore_up(&units);
+	}
+}
+
+static void urgent_thread(void *arg)
+{
+	(void)arg;
+	urgent_ran = TRUE;
+}
+
+/* Holds the mutex the high priority thread wants */
+static void low_thread(void *arg)
+{
+	(void)arg;
+
+	mutex_lock(&inherited);
+	low_locked = TRUE;
+
+	// Only runs again once it inherits the priority of the waiter, the
+	// medium priority thread spinning otherwise
+	while (!high_waiting)
+		;
+
+	boosted_priority = thread_get_current()->priority;
+
+	mutex_unlock(&inherited);
+}
+
+static void medium_thread(void *arg)
+{
+	(void)arg;
+
+	while (!high_done)
+		;
+}
+
+static void high_thread(void *arg)
+{
+	(void)arg;
+
+	high_waiting = TRUE;
+
+	// Handed over by the holder, at its inherited priority meanwhile
+	mutex_lock(&inherited);
+	mutex_unlock(&inherited);
+
+	high_done = TRUE;
+	semaphore_up(&high_finished);
+}
+
+static void controller(void *arg)
+{
+	struct thread *low, *medium, *high, *urgent;
+	struct spinlock outer = SPINLOCK_INITIALIZER;
+	struct spinlock inner = SPINLOCK_INITIALIZER;
+	uint32_t i;
+
+	(void)arg;
+
+	// Mutual exclusion
+	mutex_init(&counter_lock, 0);
+	semaphore_init(&workers_done, 0);
+	counter = 0;
+
+	for (i = 0; i < NB_WORKERS; i++)
+		assert(thread_create("worker", worker, NULL) != NULL);
+
+	for (i = 0; i < NB_WORKERS; i++)
+		semaphore_down(&workers_done);
+
+	assert(counter == NB_WORKERS * NB_ROUNDS);
+	assert(mutex_trylock(&counter_lock));
+	mutex_unlock(&counter_lock);
+
+	// Counting semaphore
+	semaphore_init(&units, 0);
+	assert(!semaphore_try_down(&units));
+	assert(thread_create("producer", producer, NULL) != NULL);
+
+	for (i = 0; i < NB_UNITS; i++)
+		semaphore_down(&units);
+
+	assert(!semaphore_try_down(&units));
+
+	// Nested spinlocks defer the preemption until the last unlock
+	spin_lock(&outer);
+	spin_lock(&inner);
+
+	urgent_ran = FALSE;
+	urgent = thread_create("urgent", urgent_thread, NULL);
+	assert(urgent != NULL);
+	scheduler_set_priority(urgent, THREAD_PRIORITY_MAX);
+	assert(!urgent_ran);
+
+	spin_unlock(&inner);
+	assert(!urgent_ran);
+	spin_unlock(&outer);
+	assert(urgent_ran);
+
+	// Priority inheritance: without it, the medium priority thread
+	// would starve the holder, and the high priority waiter with it
+	mutex_init(&inherited, MUTEX_PRIORITY_INHERITANCE);
+	semaphore_init(&high_finished, 0);
+	low_locked = high_waiting = high_done = FALSE;
+	boosted_priority = 0;
+
+	low = thread_create("low", low_thread, NULL);
+	assert(low != NULL);
+	scheduler_set_priority(low, LOW_PRIORITY);
+
+	while (!low_locked)
+		thread_sleep(1000000ULL);
+
+	medium = thread_create("medium", medium_thread, NULL);
+	assert(medium != NULL);
+	scheduler_set_priority(medium, MEDIUM_PRIORITY);
+
+	high = thread_create("high", high_thread, NULL);
+	assert(high != NULL);
+	scheduler_set_priority(high, HIGH_PRIORITY);
+
+	semaphore_down(&high_finished);
+
+	assert(boosted_priority == HIGH_PRIORITY);
+
+	printf("Synchronization: %d increments, %d units, priority %d "
+		"inherited\n", counter, NB_UNITS, boosted_priority);
+}
+
+void test_synchronization(void)
+{
+	struct thread *thr;
+
+	printf("\n\n++ Synchronization test! ++\n");
+
+	thr = thread_create("sync controller", controller, NULL);
+	assert(thr != NULL);
+	scheduler_set_priority(thr, CONTROL_PRIORITY);
+}
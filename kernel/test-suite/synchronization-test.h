@@ -0,0 +1,14 @@
+#ifndef _SYNCHRONIZATION_TEST_H_
+#define _SYNCHRONIZATION_TEST_H_
+
+/**
+ * @file synchronization-test.h
+ * @license MIT License
+ *
+ * Mutual exclusion of the mutexes, counting semaphores and the priority
+ * inheritance
+ */
+
+void test_synchronization(void);
+
+#endif // _SYNCHRONIZATION_TEST_H_
@@ -1,9 +1,17 @@
 #include <lib/libc.h>
-#include <arch/x86-all/interrupts/irq.h>
+#include <arch/x86/interrupts/irq.h>
+#include <memory/physical-memory.h>
 #include <threading/thread.h>
+#include <threading/wait-queue.h>
 
 #include "threading-test.h"
 
+#define NB_EXITING_THREADS 20
+#define REAPING_POLLS      100
+
+static struct wait_queue exited_wait;
+static volatile uint32_t nb_exited;
+
 void print_hello(void *a)
 {
 	printf("Hello ");
@@ -26,4 +34,62 @@ void test_kernel_threads(void)
 	X86_IRQs_ENABLE(flags);
 }
 
+static void short_lived(void *arg)
+{
+	void *object = malloc(64);
+	uint32_t flags;
+
+	assert(object != NULL);
+	free(object);
+
+	// Not preempted in the middle of the increment by another one
+	X86_IRQs_DISABLE(flags);
+	nb_exited++;
+	wait_queue_wake_all(&exited_wait);
+	X86_IRQs_ENABLE(flags);
+
+	// The odd threads exit explicitly, the even ones return
+	if ((uint32_t)arg & 1)
+		thread_exit();
+}
+
+static void exit_checker(void *arg)
+{
+	struct heap_statistics stats;
+	uint32_t bytes_in_use, i;
+
+	(void)arg;
+
+	wait_queue_init(&exited_wait);
+	nb_exited = 0;
+
+	heap_get_statistics(&stats);
+	bytes_in_use = stats.bytes_in_use;
+
+	for (i = 0; i < NB_EXITING_THREADS; i++)
+		assert(thread_create("exiting", short_lived, (void *)i) != NULL);
+
+	wait_event(&exited_wait, nb_exited == NB_EXITING_THREADS);
+
+	// The reaper frees the threads once they are switched out
+	for (i = 0; i < REAPING_POLLS; i++)
+	{
+		heap_get_statistics(&stats);
+
+		if (stats.bytes_in_use <= bytes_in_use)
+			break;
+
+		thread_sleep(1000000ULL);
+	}
+
+	assert(stats.bytes_in_use <= bytes_in_use);
+
+	printf("Thread exit: %d threads reaped\n", NB_EXITING_THREADS);
+}
+
+void test_thread_exit(void)
+{
+	printf("\n\n++ Thread exit test! ++\n");
 
+	assert(thread_create("exit checker", exit_checker, NULL) != NULL);
+}
@@ -8,5 +8,7 @@ void print_world(void *a);
 
 void test_kernel_threads(void);
 
+void test_thread_exit(void);
+
 
 #endif	// _THREADING_TEST_H_
@@ -0,0 +1,73 @@
+#include <lib/libc.h>
+#include <threading/thread.h>
+#include <threading/timer.h>
+
+#include "timer-test.h"
+
+#define NB_PERIODS 10
+#define PERIOD_NS  5000000ULL
+
+static struct timer periodic;
+static struct timer cancelled;
+static volatile uint32_t nb_expiries;
+static volatile bool_t cancelled_fired;
+
+/* Deferred callbacks, run by the "timers" thread */
+static void count_expiry(void *arg)
+{
+	(void)arg;
+	nb_expiries++;
+}
+
+static void must_not_fire(void *arg)
+{
+	(void)arg;
+	cancelled_fired = TRUE;
+}
+
+static void sleeper(void *arg)
+{
+	uint32_t ms, start, elapsed;
+
+	(void)arg;
+
+	// Never shorter than asked, at most one tick late plus the rounding
+	for (ms = 1; ms <= 20; ms += 3)
+	{
+		start = timer_get_ticks();
+		thread_sleep(ms * 1000000ULL);
+		elapsed = timer_get_ticks() - start;
+
+		assert(elapsed * TIMER_NS_PER_TICK >= ms * 1000000UL);
+		assert(elapsed * TIMER_NS_PER_TICK <= ms * 1000000UL
+			+ 2 * TIMER_NS_PER_TICK);
+	}
+
+	timer_init(&periodic, count_expiry, NULL, 0);
+	timer_init(&cancelled, must_not_fire, NULL, 0);
+
+	nb_expiries = 0;
+	cancelled_fired = FALSE;
+
+	timer_arm_periodic(&periodic, PERIOD_NS);
+	timer_arm(&cancelled, 2 * PERIOD_NS);
+	assert(timer_cancel(&cancelled));
+	assert(!timer_cancel(&cancelled));
+
+	thread_sleep(NB_PERIODS * PERIOD_NS);
+	timer_cancel(&periodic);
+
+	// The sleep rounding may let one more period expire
+	assert(nb_expiries >= NB_PERIODS - 1 && nb_expiries <= NB_PERIODS + 1);
+	assert(!cancelled_fired);
+
+	printf("Timers: %d periodic expiries, sleeps within one tick\n",
+		nb_expiries);
+}
+
+void test_timers(void)
+{
+	printf("\n\n++ Timers test! ++\n");
+
+	assert(thread_create("sleeper", sleeper, NULL) != NULL);
+}
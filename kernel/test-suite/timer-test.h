@@ -0,0 +1,13 @@
+#ifndef _TIMER_TEST_H_
+#define _TIMER_TEST_H_
+
+/**
+ * @file timer-test.h
+ * @license MIT License
+ *
+ * Sleeping threads and periodic timers on the timing wheel
+ */
+
+void test_timers(void);
+
+#endif // _TIMER_TEST_H_
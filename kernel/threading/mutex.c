@@ -0,0 +1,162 @@
+#include <lib/libc.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "mutex.h"
+#include "scheduler.h"
+
+/* Longest chain of holders waiting for each other the priority is passed
+ * along, a deadlock would loop forever otherwise */
+#define MUTEX_MAX_CHAIN 16
+
+/* Priority a waiter lends to the holder */
+static uint32_t waiter_priority(struct thread *thr)
+{
+	if (THREAD_CLASS_EDF == thr->scheduling_class)
+		return THREAD_PRIORITY_MAX;
+
+	return thr->priority;
+}
+
+/* Highest priority of the waiters of the mutexes a thread holds */
+static uint32_t inherited_priority(struct thread *thr)
+{
+	uint32_t priority = THREAD_PRIORITY_IDLE;
+	struct thread *waiter;
+	struct mutex *m;
+
+	TAILQ_FOREACH(m, &thr->held_mutexes, held_next)
+	{
+		TAILQ_FOREACH(waiter, &m->waiters, next)
+		{
+			if (waiter_priority(waiter) > priority)
+				priority = waiter_priority(waiter);
+		}
+	}
+
+	return priority;
+}
+
+/* Lend the priority of the waiters down the chain of holders */
+static void propagate_priority(struct mutex *m)
+{
+	struct thread *owner;
+	uint32_t depth;
+
+	for (depth = 0; m && m->owner && depth < MUTEX_MAX_CHAIN; depth++)
+	{
+		owner = m->owner;
+		scheduler_inherit_priority(owner, inherited_priority(owner));
+
+		m = owner->blocked_on;
+	}
+}
+
+static void take(struct mutex *m, struct thread *thr)
+{
+	m->owner = thr;
+
+	if (m->flags & MUTEX_PRIORITY_INHERITANCE)
+		TAILQ_INSERT_TAIL(&thr->held_mutexes, m, held_next);
+}
+
+void mutex_init(struct mutex *m, uint32_t flags)
+{
+	m->owner = NULL;
+	m->flags = flags;
+	TAILQ_INIT(&m->waiters);
+}
+
+void mutex_lock(struct mutex *m)
+{
+	struct thread *current_thread;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	current_thread = thread_get_current();
+	assert(m->owner != current_thread);
+
+	if (!m->owner)
+		take(m, current_thread);
+	else
+	{
+		TAILQ_INSERT_TAIL(&m->waiters, current_thread, next);
+
+		if (m->flags & MUTEX_PRIORITY_INHERITANCE)
+		{
+			current_thread->blocked_on = m;
+			propagate_priority(m);
+		}
+
+		/* Returns once the mutex is handed over */
+		schedule_blocked();
+
+		assert(m->owner == current_thread);
+	}
+
+	X86_IRQs_ENABLE(flags);
+}
+
+bool_t mutex_trylock(struct mutex *m)
+{
+	bool_t taken = FALSE;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	if (!m->owner)
+	{
+		take(m, thread_get_current());
+		taken = TRUE;
+	}
+
+	X86_IRQs_ENABLE(flags);
+
+	return taken;
+}
+
+void mutex_unlock(struct mutex *m)
+{
+	struct thread *current_thread, *next_owner = NULL, *waiter;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	current_thread = thread_get_current();
+	assert(m->owner == current_thread);
+
+	if (m->flags & MUTEX_PRIORITY_INHERITANCE)
+		TAILQ_REMOVE(&current_thread->held_mutexes, m, held_next);
+
+	m->owner = NULL;
+
+	/* The first of the highest priority waiters */
+	TAILQ_FOREACH(waiter, &m->waiters, next)
+	{
+		if (!next_owner
+			|| waiter_priority(waiter) > waiter_priority(next_owner))
+			next_owner = waiter;
+	}
+
+	if (next_owner)
+	{
+		TAILQ_REMOVE(&m->waiters, next_owner, next);
+		next_owner->blocked_on = NULL;
+		take(m, next_owner);
+
+		/* The remaining waiters now lend their priority to it */
+		if (m->flags & MUTEX_PRIORITY_INHERITANCE)
+			scheduler_inherit_priority(next_owner,
+				inherited_priority(next_owner));
+
+		scheduler_set_ready(next_owner);
+	}
+
+	/* Back to its own priority once the new owner is ready, so that no
+	 * thread of intermediate priority runs in between */
+	if (m->flags & MUTEX_PRIORITY_INHERITANCE)
+		scheduler_inherit_priority(current_thread,
+			inherited_priority(current_thread));
+
+	X86_IRQs_ENABLE(flags);
+}
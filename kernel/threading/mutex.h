@@ -0,0 +1,57 @@
+#ifndef _MUTEX_H_
+#define _MUTEX_H_
+
+/**
+ * @file mutex.h
+ * @license MIT License
+ *
+ * Sleeping mutexes, for the critical sections which may be long or sleep.
+ *
+ * A mutex is handed over at unlock to its highest priority waiter, first
+ * come first served among equal priorities, so that a released mutex
+ * can't be stolen by a thread which didn't wait. With the priority
+ * inheritance, the holder runs at the priority of its highest priority
+ * waiter, transitively through the mutexes the holder waits for itself,
+ * so that a real-time thread is only blocked as long as the critical
+ * section lasts. An EDF waiter counts as THREAD_PRIORITY_MAX.
+ *
+ * Mutexes can't be used from interrupt handlers, nor recursively.
+ */
+
+#include <lib/queue.h>
+#include <lib/types.h>
+
+#include "thread.h"
+
+/** The holder inherits the priority of its waiters */
+#define MUTEX_PRIORITY_INHERITANCE 0x1
+
+struct mutex
+{
+	struct thread *owner;
+	uint32_t flags;
+
+	/* Blocked threads, in arrival order */
+	TAILQ_HEAD(, thread) waiters;
+
+	/* Priority inheritance mutexes held by the owner */
+	TAILQ_ENTRY(mutex) held_next;
+};
+
+/** Initialize an unlocked mutex */
+void mutex_init(struct mutex *m, uint32_t flags);
+
+/** Take the mutex, sleeping until it is free */
+void mutex_lock(struct mutex *m);
+
+/**
+ * Take the mutex if it is free
+ *
+ * @return TRUE if it is now held by the current thread
+ */
+bool_t mutex_trylock(struct mutex *m);
+
+/** Release the mutex held by the current thread */
+void mutex_unlock(struct mutex *m);
+
+#endif // _MUTEX_H_
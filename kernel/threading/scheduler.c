@@ -1,16 +1,70 @@
 #include <lib/libc.h>
+#include <lib/status.h>
+#include <arch/x86/interrupts/irq.h>
+#include <arch/x86-pc/timer/pit.h>
+#include <arch/x86-pc/timer/clock.h>
 
 #include "scheduler.h"
+#include "timer.h"
+#include "wait-queue.h"
 
 
-TAILQ_HEAD(, thread) ready_threads_queue;
+/* One FIFO queue per priority level, and a bit set in the bitmap for
+ * each non-empty queue, so that the election is done in constant time */
+static TAILQ_HEAD(, thread) ready_queues[THREAD_PRIORITY_LEVELS];
+static uint32_t ready_bitmap;
+
+/* Ready EDF threads sorted by absolute deadline, elected before any fixed
+ * priority thread. They are few, a sorted list is enough. */
+static TAILQ_HEAD(, thread) edf_ready_queue;
+static TAILQ_HEAD(, thread) edf_threads;
+
+/* Sum of the budget / deadline densities of the admitted EDF threads,
+ * in 1/EDF_DENSITY_SCALE */
+#define EDF_DENSITY_SCALE 1024
+#define EDF_DENSITY_MAX   (EDF_DENSITY_SCALE * EDF_UTILIZATION_MAX / 100)
+static uint32_t edf_density;
+
+/* Ticks used by the current thread of its round-robin time slice */
+static uint32_t slice_used;
+static uint32_t last_tick;
+
+/* The current thread switches once done, not in the middle: the timer
+ * interrupt, or an exiting thread */
+static bool_t switching = FALSE;
+
+/* Preemption disabled by the spinlocks: a switch due meanwhile is done
+ * once it is enabled again */
+static volatile uint32_t preempt_count = 0;
+static bool_t preempt_pending = FALSE;
+
+/* Tick comparison which survives the wrap around of the counter */
+#define TICK_BEFORE(a, b) ((int32_t)((a) - (b)) < 0)
+
+/* Preemption can only happen once the current thread is setup */
+static bool_t scheduler_running = FALSE;
 
 void scheduler_setup(void)
 {
-	TAILQ_INIT(&ready_threads_queue);
+	uint32_t priority;
+
+	for (priority = 0; priority < THREAD_PRIORITY_LEVELS; priority++)
+		TAILQ_INIT(&ready_queues[priority]);
+
+	ready_bitmap = 0;
+
+	TAILQ_INIT(&edf_ready_queue);
+	TAILQ_INIT(&edf_threads);
+	edf_density = 0;
 }
 
 
+/* Highest priority of the ready threads, the bitmap must not be empty */
+static inline uint32_t highest_ready_priority(void)
+{
+	return 31 - __builtin_clz(ready_bitmap);	/* bsr */
+}
+
 /*
  * Helper function to add a thread in a ready queue AND to change
  * the state of the given thread to "READY".
@@ -26,52 +80,519 @@ static void add_in_ready_queue(struct thread *thr,
 		|| (THREAD_RUNNING == thr->state) /* Yield */
 		|| (THREAD_BLOCKED == thr->state) );
 
+	/* Woken up or new: the latency until it runs is measured, not the
+	 * time a preempted thread waits */
+	thr->statistics.ready_since = clock_now_ns();
+	thr->statistics.woken_up    = (THREAD_RUNNING != thr->state);
+
 	/* Ok, thread is now really ready to be (re)started */
 	thr->state = THREAD_READY;
 
-	/* Add the thread to the threads queue */
+	if (THREAD_CLASS_EDF == thr->scheduling_class)
+	{
+		struct thread *other;
+
+		/* Keep the deadline order, FIFO among equal deadlines unless
+		 * the thread goes back at the head */
+		TAILQ_FOREACH(other, &edf_ready_queue, next)
+		{
+			if (TICK_BEFORE(thr->edf.absolute_deadline,
+					other->edf.absolute_deadline)
+				|| (!insert_at_tail && thr->edf.absolute_deadline
+					== other->edf.absolute_deadline))
+				break;
+		}
+
+		if (other)
+			TAILQ_INSERT_BEFORE(other, thr, next);
+		else
+			TAILQ_INSERT_TAIL(&edf_ready_queue, thr, next);
+
+		return;
+	}
+
+	/* Add the thread to the queue of its priority */
 	if (insert_at_tail)
-		TAILQ_INSERT_TAIL(&ready_threads_queue, thr, next);
+		TAILQ_INSERT_TAIL(&ready_queues[thr->priority], thr, next);
 	else
-		TAILQ_INSERT_HEAD(&ready_threads_queue, thr, next);
+		TAILQ_INSERT_HEAD(&ready_queues[thr->priority], thr, next);
+
+	ready_bitmap |= 1U << thr->priority;
+}
+
+static void remove_from_ready_queue(struct thread *thr)
+{
+	if (THREAD_CLASS_EDF == thr->scheduling_class)
+	{
+		TAILQ_REMOVE(&edf_ready_queue, thr, next);
+		return;
+	}
+
+	TAILQ_REMOVE(&ready_queues[thr->priority], thr, next);
+
+	if (TAILQ_EMPTY(&ready_queues[thr->priority]))
+		ready_bitmap &= ~(1U << thr->priority);
+}
+
+/*
+ * Whether the thread about to run, out of the ready queues, needs the
+ * ticks: EDF budget accounting, or round-robin with ready peers
+ */
+static bool_t tick_needed(struct thread *thr)
+{
+	if (THREAD_CLASS_EDF == thr->scheduling_class
+		|| !TAILQ_EMPTY(&edf_ready_queue))
+		return TRUE;
+
+	return (ready_bitmap >> thr->priority) != 0;
+}
+
+/*
+ * Tickless: the timer only interrupts when the scheduler has something to
+ * do. A lone thread, the idle one included, runs until the next timer
+ * expiry or an interrupt which wakes another thread up.
+ */
+static void program_timer(struct thread *thr)
+{
+	timer_wheel_program(tick_needed(thr));
+}
+
+/*
+ * Elect the next ready thread and switch to it. The current thread must
+ * already be back in the ready queue, blocked or otherwise accounted for.
+ */
+static void switch_to_next_thread(struct thread *current_thread)
+{
+	struct thread *next_thread;
+
+	/* Earliest deadline first, then the highest fixed priority */
+	next_thread = TAILQ_FIRST(&edf_ready_queue);
+
+	if (!next_thread)
+	{
+		assert(ready_bitmap != 0);
+		next_thread = TAILQ_FIRST(&ready_queues[highest_ready_priority()]);
+	}
+
+	remove_from_ready_queue(next_thread);
+
+	program_timer(next_thread);
+	slice_used = 0;
+
+	thread_set_current(next_thread);
+	x86_fpu_switch(&next_thread->fpu);
+
+	// Avoid context switch if the context does not change
+	if (current_thread != next_thread)
+	{
+		/* Preempted threads are back in the ready queue */
+		if (THREAD_READY == current_thread->state)
+			current_thread->statistics.involuntary_switches++;
+		else
+			current_thread->statistics.voluntary_switches++;
+
+		cpu_context_switch(&current_thread->cpu_state, next_thread->cpu_state);
+
+		assert(current_thread == thread_get_current());
+		assert(current_thread->state == THREAD_RUNNING);
+	}
+}
+
+/* Whether a ready thread should run instead of the current one */
+static bool_t must_preempt(struct thread *current_thread)
+{
+	struct thread *edf_first = TAILQ_FIRST(&edf_ready_queue);
+
+	if (THREAD_CLASS_EDF == current_thread->scheduling_class)
+		return edf_first != NULL
+			&& TICK_BEFORE(edf_first->edf.absolute_deadline,
+				current_thread->edf.absolute_deadline);
+
+	if (edf_first)
+		return TRUE;
+
+	return ready_bitmap != 0
+		&& highest_ready_priority() > current_thread->priority;
+}
+
+/*
+ * Give the CPU to a ready thread of higher priority or earlier deadline
+ * than the current one, if any. The preempted thread stays first of its
+ * level.
+ */
+static void preempt_if_needed(void)
+{
+	struct thread *current_thread;
+
+	if (!scheduler_running || switching)
+		return;
+
+	if (preempt_count)
+	{
+		preempt_pending = TRUE;
+		return;
+	}
+
+	current_thread = thread_get_current();
+
+	if (!must_preempt(current_thread))
+		return;
+
+	add_in_ready_queue(current_thread, FALSE);
+	switch_to_next_thread(current_thread);
 }
 
 uint32_t scheduler_set_ready(struct thread *thr)
 {
+	uint32_t flags;
+
 	/* Don't do anything for already ready threads */
 	if (THREAD_READY == thr->state)
 		return KERNEL_OK;
 
-	/* Real-time thread: schedule it for the present turn */
+	X86_IRQs_DISABLE(flags);
+
 	add_in_ready_queue(thr, TRUE);
 
+	/* Real-time thread: a higher priority runs right away, even when
+	 * woken up by an interrupt handler */
+	preempt_if_needed();
+
+	X86_IRQs_ENABLE(flags);
+
 	return KERNEL_OK;
 }
 
-void schedule(void)
+/* Leave the EDF band and give its bandwidth back, IRQs disabled */
+static void edf_leave(struct thread *thr)
+{
+	timer_cancel(&thr->edf.release_timer);
+
+	edf_density -= thr->edf.budget * EDF_DENSITY_SCALE
+			/ thr->edf.relative_deadline;
+	TAILQ_REMOVE(&edf_threads, thr, edf.edf_threads_next);
+
+	/* Throttled or between two jobs: runnable again in the new class */
+	if (thr->edf.waiting_release)
+	{
+		thr->edf.waiting_release = FALSE;
+		thr->scheduling_class    = THREAD_CLASS_FIXED_PRIORITY;
+		add_in_ready_queue(thr, TRUE);
+	}
+
+	thr->scheduling_class = THREAD_CLASS_FIXED_PRIORITY;
+}
+
+/*
+ * Move a thread to its effective priority, the highest of its own and of
+ * the inherited one, IRQs disabled
+ */
+static void update_priority(struct thread *thr, bool_t leave_edf)
+{
+	bool_t ready = (THREAD_READY == thr->state);
+
+	if (ready)
+	{
+		remove_from_ready_queue(thr);
+		thr->state = THREAD_CREATED;
+	}
+
+	thr->priority = (thr->inherited_priority > thr->base_priority)
+			? thr->inherited_priority : thr->base_priority;
+
+	if (leave_edf && THREAD_CLASS_EDF == thr->scheduling_class)
+		edf_leave(thr);
+
+	if (ready)
+		add_in_ready_queue(thr, TRUE);
+
+	preempt_if_needed();
+
+	if (scheduler_running && !switching)
+		program_timer(thread_get_current());
+}
+
+void scheduler_set_priority(struct thread *thr, uint32_t priority)
+{
+	uint32_t flags;
+
+	assert(priority < THREAD_PRIORITY_LEVELS);
+
+	X86_IRQs_DISABLE(flags);
+
+	thr->base_priority = priority;
+	update_priority(thr, TRUE);
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void scheduler_inherit_priority(struct thread *thr, uint32_t priority)
+{
+	uint32_t flags;
+
+	assert(priority < THREAD_PRIORITY_LEVELS);
+
+	X86_IRQs_DISABLE(flags);
+
+	thr->inherited_priority = priority;
+	update_priority(thr, FALSE);
+
+	X86_IRQs_ENABLE(flags);
+}
+
+/*
+ * Start a new job of an EDF thread, from its periodic release timer in
+ * the timer interrupt
+ */
+static void edf_release_job(void *arg)
+{
+	struct thread *thr = arg;
+
+	/* The previous job is still there at its next release, past its
+	 * deadline since the deadline is at most the period */
+	if (!thr->edf.job_completed)
+		thr->edf.deadline_misses++;
+
+	thr->edf.absolute_deadline = timer_get_ticks()
+					+ thr->edf.relative_deadline;
+	thr->edf.remaining_budget  = thr->edf.budget;
+	thr->edf.job_completed     = FALSE;
+
+	if (thr->edf.waiting_release)
+	{
+		thr->edf.waiting_release = FALSE;
+		add_in_ready_queue(thr, TRUE);
+	}
+}
+
+ret_t scheduler_set_edf(struct thread *thr, uint32_t period,
+			uint32_t budget, uint32_t deadline)
+{
+	uint32_t flags, density;
+	bool_t   ready;
+
+	if (budget == 0 || budget > deadline || deadline > period)
+		return -KERNEL_INVALID_VALUE;
+
+	density = budget * EDF_DENSITY_SCALE / deadline;
+
+	X86_IRQs_DISABLE(flags);
+
+	if (THREAD_CLASS_EDF == thr->scheduling_class)
+		density -= thr->edf.budget * EDF_DENSITY_SCALE
+				/ thr->edf.relative_deadline;
+
+	/* Admission control: sum of the densities at most 1, minus the
+	 * share kept for the fixed priority threads */
+	if (edf_density + density > EDF_DENSITY_MAX)
+	{
+		X86_IRQs_ENABLE(flags);
+		return -KERNEL_BUSY;
+	}
+
+	ready = (THREAD_READY == thr->state);
+
+	if (ready)
+	{
+		remove_from_ready_queue(thr);
+		thr->state = THREAD_CREATED;
+	}
+
+	if (THREAD_CLASS_FIXED_PRIORITY == thr->scheduling_class)
+	{
+		TAILQ_INSERT_TAIL(&edf_threads, thr, edf.edf_threads_next);
+		thr->scheduling_class = THREAD_CLASS_EDF;
+	}
+
+	edf_density += density;
+
+	/* The first job is released right now, the next ones every period */
+	thr->edf.period            = period;
+	thr->edf.budget            = budget;
+	thr->edf.relative_deadline = deadline;
+	thr->edf.job_completed     = TRUE;
+	edf_release_job(thr);
+
+	timer_cancel(&thr->edf.release_timer);
+	timer_init(&thr->edf.release_timer, edf_release_job, thr, TIMER_IRQ);
+	timer_arm_ticks(&thr->edf.release_timer, period, period);
+
+	if (ready)
+		add_in_ready_queue(thr, TRUE);
+
+	preempt_if_needed();
+
+	if (scheduler_running && !switching)
+		program_timer(thread_get_current());
+
+	X86_IRQs_ENABLE(flags);
+
+	return KERNEL_OK;
+}
+
+void scheduler_edf_wait_next_period(void)
 {
 	struct thread *current_thread;
-	struct thread *next_thread;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
 
 	current_thread = thread_get_current();
+	assert(THREAD_CLASS_EDF == current_thread->scheduling_class);
 
-	if (current_thread->state != THREAD_BLOCKED)
-		add_in_ready_queue(current_thread, TRUE);
+	if (!current_thread->edf.job_completed
+		&& TICK_BEFORE(current_thread->edf.absolute_deadline,
+			timer_get_ticks()))
+		current_thread->edf.deadline_misses++;
 
-	assert(TAILQ_EMPTY(&ready_threads_queue) == FALSE);
+	current_thread->edf.job_completed   = TRUE;
+	current_thread->edf.waiting_release = TRUE;
+	schedule_blocked();
 
-	next_thread = TAILQ_FIRST(&ready_threads_queue);
-	TAILQ_REMOVE(&ready_threads_queue, next_thread, next);
-	TAILQ_INSERT_TAIL(&ready_threads_queue, next_thread, next);
+	X86_IRQs_ENABLE(flags);
+}
 
-	thread_set_current(next_thread);
+/*
+ * Switch if the current thread is throttled, at the end of its time slice
+ * or preempted. Called once the timers expired, IRQs disabled.
+ */
+static void reschedule(struct thread *current_thread)
+{
+	/* Budget enforcement: the job is throttled until its next release,
+	 * unless the release just refilled its budget */
+	if (THREAD_CLASS_EDF == current_thread->scheduling_class
+		&& current_thread->edf.remaining_budget == 0)
+	{
+		current_thread->edf.budget_overruns++;
+		current_thread->edf.waiting_release = TRUE;
+		current_thread->state = THREAD_BLOCKED;
+		switch_to_next_thread(current_thread);
+	}
+	else if (slice_used >= SCHEDULER_TIME_SLICE)
+		schedule();
+	else if (must_preempt(current_thread))
+	{
+		add_in_ready_queue(current_thread, FALSE);
+		switch_to_next_thread(current_thread);
+	}
+	else
+		program_timer(current_thread);
+}
 
-	// Avoid context switch if the context does not change
-	if (current_thread != next_thread)
+void scheduler_tick(void)
+{
+	struct thread *current_thread;
+	uint32_t now, elapsed;
+
+	current_thread = thread_get_current();
+	now = timer_get_ticks();
+
+	elapsed    = now - last_tick;
+	last_tick  = now;
+	slice_used += elapsed;
+
+	/* The ticks are charged to the running job */
+	if (THREAD_CLASS_EDF == current_thread->scheduling_class)
 	{
-		cpu_context_switch(&current_thread->cpu_state, next_thread->cpu_state);
+		if (current_thread->edf.remaining_budget > elapsed)
+			current_thread->edf.remaining_budget -= elapsed;
+		else
+			current_thread->edf.remaining_budget = 0;
+	}
 
-		assert(current_thread == thread_get_current());
-		assert(current_thread->state == THREAD_RUNNING);
+	/* Job releases, sleeping threads woken up, deferred callbacks */
+	switching = TRUE;
+	timer_wheel_run();
+	switching = FALSE;
+
+	/* In a critical section: keep ticking until it ends */
+	if (preempt_count)
+	{
+		preempt_pending = TRUE;
+		timer_wheel_program(TRUE);
+		return;
 	}
+
+	reschedule(current_thread);
+}
+
+void preempt_disable(void)
+{
+	preempt_count++;
+}
+
+void preempt_enable(void)
+{
+	uint32_t flags;
+
+	assert(preempt_count > 0);
+
+	if (--preempt_count || !preempt_pending)
+		return;
+
+	/* Checked again: the timer interrupt may have switched already */
+	X86_IRQs_DISABLE(flags);
+
+	if (!preempt_count && preempt_pending)
+	{
+		preempt_pending = FALSE;
+		reschedule(thread_get_current());
+	}
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void scheduler_start(struct thread *thr)
+{
+	remove_from_ready_queue(thr);
+	program_timer(thr);
+	thread_set_current(thr);
+	x86_fpu_switch(&thr->fpu);
+
+	scheduler_running = TRUE;
+}
+
+void schedule(void)
+{
+	struct thread *current_thread;
+
+	current_thread = thread_get_current();
+
+	/* Round-robin among the threads of the same priority */
+	add_in_ready_queue(current_thread, TRUE);
+
+	switch_to_next_thread(current_thread);
+}
+
+void schedule_blocked(void)
+{
+	struct thread *current_thread;
+
+	/* A spinlock holder must not sleep */
+	assert(preempt_count == 0);
+
+	current_thread = thread_get_current();
+	current_thread->state = THREAD_BLOCKED;
+
+	switch_to_next_thread(current_thread);
+}
+
+void schedule_exit(struct wait_queue *reaper_wait)
+{
+	struct thread *current_thread;
+
+	current_thread = thread_get_current();
+
+	if (THREAD_CLASS_EDF == current_thread->scheduling_class)
+		edf_leave(current_thread);
+
+	/* The reaper must not preempt the zombie still on its stack */
+	switching = TRUE;
+	wait_queue_wake_one(reaper_wait);
+	switching = FALSE;
+
+	current_thread->state = THREAD_ZOMBIE;
+	switch_to_next_thread(current_thread);
+
+	panic("Zombie thread elected again");
 }
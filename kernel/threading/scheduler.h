@@ -5,10 +5,90 @@
 
 #include "thread.h"
 
+struct wait_queue;
+
+/*
+ * Share of the CPU the EDF threads may reserve, in percent. The rest is
+ * left to the fixed priority threads.
+ */
+#define EDF_UTILIZATION_MAX 90
+
+/*
+ * Ticks a fixed priority thread runs before the next ready thread of the
+ * same priority
+ */
+#define SCHEDULER_TIME_SLICE 10
+
 void scheduler_setup(void);
 
+/*
+ * Elect the first thread, the one already running the code of the
+ * caller, and enable the preemption
+ */
+void scheduler_start(struct thread *thr);
+
+/*
+ * Make a thread ready. It preempts the current thread right away if
+ * its priority is higher.
+ */
 uint32_t scheduler_set_ready(struct thread * thr);
 
+/*
+ * Change the priority of a thread, the current thread is preempted if
+ * a ready thread has now a higher priority
+ */
+void scheduler_set_priority(struct thread *thr, uint32_t priority);
+
+/*
+ * Raise the priority of a thread to the given one, or drop it back to its
+ * own with THREAD_PRIORITY_IDLE, without leaving the EDF band. Used by the
+ * priority inheritance mutexes.
+ */
+void scheduler_inherit_priority(struct thread *thr, uint32_t priority);
+
+/*
+ * Move a thread to the EDF band: a job is released every period ticks,
+ * it may run budget ticks and should complete within deadline ticks.
+ * Returns -KERNEL_BUSY when the sum of the budget / deadline densities
+ * would exceed EDF_UTILIZATION_MAX. scheduler_set_priority() moves the
+ * thread back to the fixed priorities.
+ */
+ret_t scheduler_set_edf(struct thread *thr, uint32_t period,
+			uint32_t budget, uint32_t deadline);
+
+/*
+ * Complete the current job of the calling EDF thread and sleep until the
+ * release of the next one
+ */
+void scheduler_edf_wait_next_period(void);
+
+/*
+ * Account the elapsed ticks: EDF budget enforcement, expired timers, then
+ * round-robin. Called from the timer interrupt with IRQs disabled.
+ */
+void scheduler_tick(void);
+
+/*
+ * Disable the preemption of the current thread, nested. The interrupts
+ * stay enabled, a switch due meanwhile happens in preempt_enable().
+ */
+void preempt_disable(void);
+void preempt_enable(void);
+
 void schedule(void);
 
+/*
+ * Block the current thread and switch to the next ready one. The caller
+ * must have recorded the thread somewhere it will be woken up from
+ * (a wait queue) and must run with IRQs disabled.
+ */
+void schedule_blocked(void);
+
+/*
+ * Make the current thread a zombie and switch to the next ready one for
+ * good, after waking up the reaper which frees it. The caller must have
+ * queued the thread for the reaper and must run with IRQs disabled.
+ */
+void schedule_exit(struct wait_queue *reaper_wait) __attribute__((noreturn));
+
 #endif // _SCHEDULER_H_
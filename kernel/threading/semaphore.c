@@ -0,0 +1,56 @@
+#include <lib/libc.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "semaphore.h"
+
+void semaphore_init(struct semaphore *s, uint32_t count)
+{
+	s->count = count;
+	wait_queue_init(&s->waiters);
+}
+
+void semaphore_down(struct semaphore *s)
+{
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	/* A woken up thread may find the unit taken by a thread which ran
+	 * first, it then sleeps again */
+	while (s->count == 0)
+		wait_queue_sleep(&s->waiters);
+
+	s->count--;
+
+	X86_IRQs_ENABLE(flags);
+}
+
+bool_t semaphore_try_down(struct semaphore *s)
+{
+	bool_t taken = FALSE;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	if (s->count)
+	{
+		s->count--;
+		taken = TRUE;
+	}
+
+	X86_IRQs_ENABLE(flags);
+
+	return taken;
+}
+
+void semaphore_up(struct semaphore *s)
+{
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+
+	s->count++;
+	wait_queue_wake_one(&s->waiters);
+
+	X86_IRQs_ENABLE(flags);
+}
@@ -0,0 +1,40 @@
+#ifndef _SEMAPHORE_H_
+#define _SEMAPHORE_H_
+
+/**
+ * @file semaphore.h
+ * @license MIT License
+ *
+ * Counting semaphores. The count of available units is taken by
+ * semaphore_down(), which sleeps while it is zero, and given back by
+ * semaphore_up(), which an interrupt handler can call to signal a thread.
+ */
+
+#include <lib/types.h>
+
+#include "wait-queue.h"
+
+struct semaphore
+{
+	uint32_t count;
+	struct wait_queue waiters;
+};
+
+/** Initialize a semaphore with the given count of available units */
+void semaphore_init(struct semaphore *s, uint32_t count);
+
+/** Take a unit, sleeping until one is available */
+void semaphore_down(struct semaphore *s);
+
+/**
+ * Take a unit if one is available
+ *
+ * @return TRUE if a unit was taken
+ */
+bool_t semaphore_try_down(struct semaphore *s);
+
+/** Give a unit back and wake up a waiter. Can be called from an
+ * interrupt handler. */
+void semaphore_up(struct semaphore *s);
+
+#endif // _SEMAPHORE_H_
@@ -0,0 +1,63 @@
+#ifndef _SPINLOCK_H_
+#define _SPINLOCK_H_
+
+/**
+ * @file spinlock.h
+ * @license MIT License
+ *
+ * Spinlocks for the short critical sections.
+ *
+ * On a uniprocessor, nobody can hold the lock while the holder runs, so
+ * taking it only disables the preemption: the interrupts stay enabled.
+ * The holder must not sleep. Data shared with an interrupt handler needs
+ * spin_lock_irqsave() instead, which also disables the interrupts.
+ */
+
+#include <lib/libc.h>
+#include <lib/types.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "scheduler.h"
+
+struct spinlock
+{
+	volatile bool_t locked;
+};
+
+#define SPINLOCK_INITIALIZER { FALSE }
+
+static inline void spinlock_init(struct spinlock *lock)
+{
+	lock->locked = FALSE;
+}
+
+static inline void spin_lock(struct spinlock *lock)
+{
+	preempt_disable();
+
+	/* Only held by the current thread, taking it again deadlocks */
+	assert(!lock->locked);
+	lock->locked = TRUE;
+}
+
+static inline void spin_unlock(struct spinlock *lock)
+{
+	assert(lock->locked);
+	lock->locked = FALSE;
+
+	preempt_enable();
+}
+
+#define spin_lock_irqsave(lock, flags)		\
+	({					\
+		X86_IRQs_DISABLE(flags);	\
+		spin_lock(lock);		\
+	})
+
+#define spin_unlock_irqrestore(lock, flags)	\
+	({					\
+		spin_unlock(lock);		\
+		X86_IRQs_ENABLE(flags);		\
+	})
+
+#endif // _SPINLOCK_H_
@@ -0,0 +1,218 @@
+#include <lib/libc.h>
+#include <lib/status.h>
+#include <arch/x86/interrupts/irq.h>
+#include <arch/x86/mmu/paging.h>
+
+#include "stack.h"
+#include "spinlock.h"
+#include "timer.h"
+
+#define STACK_REGION_END   (STACK_REGION_START \
+				+ STACK_NB_SLOTS * STACK_SLOT_SIZE)
+
+/* Frames kept aside for the page fault handler, which can't call the
+ * frame allocator since the fault may have interrupted it */
+#define RESERVE_SIZE	32
+
+/* Below it, a fault asks the "timers" thread for a refill */
+#define RESERVE_LOW	(RESERVE_SIZE / 2)
+
+/* Slot of a stack address */
+#define SLOT_OF(address) (((address) - STACK_REGION_START) / STACK_SLOT_SIZE)
+
+/* Page fault error code: the page was present */
+#define PAGE_FAULT_PROTECTION	0x1
+
+#define PAGE_FLAGS	(X86_PAGING_WRITABLE | X86_PAGING_GLOBAL)
+
+static uint32_t used_slots[STACK_NB_SLOTS / 32];
+
+/* Between the threads: the slots and the reserve */
+static struct spinlock stacks_lock = SPINLOCK_INITIALIZER;
+
+/* Only updated without any call between the read and the write of
+ * nb_reserved, a fault can thus only happen in between when the
+ * reserve is consistent */
+static void *reserve[RESERVE_SIZE];
+static volatile uint32_t nb_reserved;
+
+/* Tops the reserve up from the "timers" thread. Set while the timer is
+ * armed or pending, and until stack_refill_setup() initializes it. */
+static struct timer refill_timer;
+static volatile bool_t refill_requested = TRUE;
+
+
+static void fill_reserve(void)
+{
+	spin_lock(&stacks_lock);
+
+	while (nb_reserved < RESERVE_SIZE)
+	{
+		void *frame = physical_memory_page_reference_new();
+
+		if (!frame)
+			break;
+
+		reserve[nb_reserved++] = frame;
+	}
+
+	spin_unlock(&stacks_lock);
+}
+
+static ret_t commit_page(vaddr_t page)
+{
+	if (nb_reserved == 0)
+		return -KERNEL_NO_MEMORY;
+
+	return x86_paging_map(page, (paddr_t)reserve[--nb_reserved], PAGE_FLAGS);
+}
+
+static void refill_reserve(void *arg)
+{
+	(void)arg;
+
+	refill_requested = FALSE;
+	fill_reserve();
+}
+
+static ret_t stack_page_fault(vaddr_t address, uint32_t error_code,
+		vaddr_t stack_pointer, uint32_t eflags)
+{
+	uint32_t slot, offset;
+	ret_t status;
+
+	if (address < STACK_REGION_START
+		|| address >= STACK_REGION_END
+		|| (error_code & PAGE_FAULT_PROTECTION))
+		return -KERNEL_INVALID_VALUE;
+
+	slot   = SLOT_OF(address);
+	offset = (address - STACK_REGION_START) % STACK_SLOT_SIZE;
+
+	if (!(used_slots[slot / 32] & (1U << (slot % 32))))
+		return -KERNEL_INVALID_VALUE;
+
+	/* A thread only grows its own stack, the one ESP is in. ESP is at
+	 * the top of the slot when the stack is empty. */
+	if (stack_pointer <= STACK_REGION_START
+		|| stack_pointer > STACK_REGION_END
+		|| SLOT_OF(stack_pointer - 1) != slot)
+		return -KERNEL_INVALID_VALUE;
+
+	if (offset < STACK_GUARD_SIZE)
+	{
+		printf(">> Kernel stack overflow <<\n");
+		return -KERNEL_INVALID_VALUE;
+	}
+
+	status = commit_page(PAGE_ALIGN_DOWN(address));
+
+	/* The timers are consistent as for an IRQ handler only if the faulting
+	 * code could be interrupted. Otherwise a later fault or stack_alloc()
+	 * tops the reserve up. */
+	if (nb_reserved < RESERVE_LOW && !refill_requested
+		&& (eflags & X86_EFLAGS_IF))
+	{
+		refill_requested = TRUE;
+		timer_arm_ticks(&refill_timer, 1, 0);
+	}
+
+	return status;
+}
+
+
+void stack_setup(void)
+{
+	vaddr_t address;
+
+	assert(physical_memory_get_ram_end() <= STACK_REGION_START);
+
+	// The page tables are allocated now, the fault handler only fills them
+	for (address = STACK_REGION_START;
+		address < STACK_REGION_END;
+		address += X86_PAGING_LARGE_SIZE)
+	{
+		if (x86_paging_unmap(address) != KERNEL_OK)
+			panic("No memory for the stacks' page tables");
+	}
+
+	fill_reserve();
+
+	x86_paging_set_fault_handler(stack_page_fault);
+}
+
+void stack_refill_setup(void)
+{
+	timer_init(&refill_timer, refill_reserve, NULL, 0);
+	refill_requested = FALSE;
+}
+
+vaddr_t stack_alloc(void)
+{
+	uint32_t word, slot;
+	vaddr_t base;
+	ret_t status;
+
+	fill_reserve();
+
+	spin_lock(&stacks_lock);
+
+	for (word = 0; word < STACK_NB_SLOTS / 32; word++)
+	{
+		if (used_slots[word] != 0xFFFFFFFF)
+			break;
+	}
+
+	if (word == STACK_NB_SLOTS / 32)
+	{
+		spin_unlock(&stacks_lock);
+		return 0;
+	}
+
+	slot = word * 32 + __builtin_ctz(~used_slots[word]);
+	used_slots[word] |= 1U << (slot % 32);
+
+	base = STACK_REGION_START + slot * STACK_SLOT_SIZE + STACK_GUARD_SIZE;
+
+	// The initial CPU context is stored on the top page
+	status = commit_page(base + STACK_MAX_SIZE - X86_PAGE_SIZE);
+
+	spin_unlock(&stacks_lock);
+
+	if (status != KERNEL_OK)
+	{
+		stack_free(base);
+		return 0;
+	}
+
+	return base;
+}
+
+void stack_free(vaddr_t stack_base_address)
+{
+	uint32_t slot = (stack_base_address - STACK_REGION_START) / STACK_SLOT_SIZE;
+	vaddr_t page;
+
+	spin_lock(&stacks_lock);
+
+	for (page = stack_base_address;
+		page < stack_base_address + STACK_MAX_SIZE;
+		page += X86_PAGE_SIZE)
+	{
+		paddr_t frame = x86_paging_get_physical(page);
+
+		if (!frame)
+			continue;
+
+		x86_paging_unmap(page);
+
+		if (nb_reserved < RESERVE_SIZE)
+			reserve[nb_reserved++] = (void *)frame;
+		else
+			physical_memory_page_unreference(frame);
+	}
+
+	used_slots[slot / 32] &= ~(1U << (slot % 32));
+
+	spin_unlock(&stacks_lock);
+}
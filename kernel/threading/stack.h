@@ -0,0 +1,50 @@
+#ifndef _STACK_H_
+#define _STACK_H_
+
+/**
+ * @file stack.h
+ * @license MIT License
+ *
+ * Kernel threads' stacks.
+ *
+ * Each stack lives in a slot of a virtual region reserved above the
+ * identity mapped RAM, below which an unmapped guard page catches the
+ * overflows. Only the top page is committed when the stack is
+ * allocated, deeper pages are mapped by the page fault handler the
+ * first time they are touched.
+ */
+
+#include <lib/types.h>
+#include <memory/physical-memory.h>
+
+/** Virtual region of the stacks: 256 slots of 64 KiB */
+#define STACK_REGION_START 0xF0000000
+#define STACK_SLOT_SIZE    (16 * X86_PAGE_SIZE)
+#define STACK_NB_SLOTS     256
+
+/** Unmapped page at the bottom of each slot */
+#define STACK_GUARD_SIZE   X86_PAGE_SIZE
+
+/** Largest size a stack can grow to */
+#define STACK_MAX_SIZE     (STACK_SLOT_SIZE - STACK_GUARD_SIZE)
+
+/** Reserve the region and handle the page faults in it */
+void stack_setup(void);
+
+/**
+ * Let the page fault handler have its frames refilled by the "timers"
+ * thread once they run low, the timers must be setup
+ */
+void stack_refill_setup(void);
+
+/**
+ * Allocate a stack of STACK_MAX_SIZE bytes
+ *
+ * @return Its lowest address, or 0 if no slot or no memory is left
+ */
+vaddr_t stack_alloc(void);
+
+/** Release a stack and its committed pages */
+void stack_free(vaddr_t stack_base_address);
+
+#endif // _STACK_H_
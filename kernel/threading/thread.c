@@ -1,12 +1,18 @@
 #include <lib/libc.h>
 #include <lib/status.h>
 #include <arch/x86/interrupts/irq.h>
+#include <arch/x86-pc/timer/clock.h>
 
 #include "thread.h"
 #include "scheduler.h"
+#include "wait-queue.h"
 
 TAILQ_HEAD(, thread) kernel_threads;
 
+/* Exited threads, freed by the reaper once off their stack */
+static TAILQ_HEAD(, thread) zombie_threads;
+static struct wait_queue reaper_wait;
+
 static volatile struct thread *g_current_thread = NULL;
 
 static void idle_thread()
@@ -17,12 +23,52 @@ static void idle_thread()
     }
 }
 
+/* Histogram bucket of a latency: log2 of its 1024 ns units */
+static uint32_t latency_bucket(uint32_t latency)
+{
+	uint32_t units = latency >> 10, bucket;
+
+	if (!units)
+		return 0;
+
+	bucket = 32 - __builtin_clz(units);	/* bsr + 1 */
+
+	return (bucket < THREAD_LATENCY_BUCKETS)
+		? bucket : THREAD_LATENCY_BUCKETS - 1;
+}
+
 inline void thread_set_current(struct thread *current_thread)
 {
+	struct thread_statistics *stats = &current_thread->statistics;
+	uint64_t now = clock_now_ns();
+	uint32_t latency;
+
 	assert(current_thread->state == THREAD_READY);
 
+	/* CPU time of the thread switched out, or elected again */
+	if (g_current_thread)
+		g_current_thread->statistics.run_time +=
+			now - g_current_thread->statistics.running_since;
+
+	if (stats->woken_up)
+	{
+		latency = (now - stats->ready_since > 0xFFFFFFFFULL)
+			? 0xFFFFFFFF : (uint32_t)(now - stats->ready_since);
+
+		stats->woken_up = FALSE;
+		stats->wake_ups++;
+		stats->latency_histogram[latency_bucket(latency)]++;
+
+		if (latency > stats->max_latency)
+			stats->max_latency = latency;
+	}
+
+	stats->running_since = now;
+
 	g_current_thread        = current_thread;
 	g_current_thread->state = THREAD_RUNNING;
+
+	magazine_set_current(&current_thread->magazines);
 }
 
 struct thread *thread_get_current(void)
@@ -31,16 +77,60 @@ struct thread *thread_get_current(void)
 	return (struct thread *)g_current_thread;
 }
 
+/* Frees the stack and the structure of the exited threads */
+static void reaper_thread(void *arg)
+{
+	struct thread *zombie;
+	uint32_t flags;
+
+	(void)arg;
+
+	while (1)
+	{
+		wait_event(&reaper_wait, !TAILQ_EMPTY(&zombie_threads));
+
+		X86_IRQs_DISABLE(flags);
+		zombie = TAILQ_FIRST(&zombie_threads);
+		TAILQ_REMOVE(&zombie_threads, zombie, kernel_threads_next);
+		X86_IRQs_ENABLE(flags);
+
+		assert(THREAD_ZOMBIE == zombie->state);
+
+		/* Give the cached objects back to the shared caches */
+		magazine_drain(&zombie->magazines);
+		x86_fpu_release(&zombie->fpu);
+		stack_free(zombie->stack_base_address);
+		free(zombie);
+	}
+}
+
+/* Called once the start function of a thread returns */
+static void thread_exit_routine(uint32_t arg)
+{
+	(void)arg;
+	thread_exit();
+}
+
 void threading_setup(void)
 {
+	struct thread *reaper;
+
 	TAILQ_INIT(&kernel_threads);
+	TAILQ_INIT(&zombie_threads);
+	wait_queue_init(&reaper_wait);
 
 	// Declare the idle thread
 	struct thread *idle = thread_create("idle", idle_thread, NULL);
 	assert(idle != NULL);
 
-	idle->state = THREAD_READY;
-	thread_set_current(idle);
+	/* Created before the preemption is enabled, it runs once the boot
+	 * flow blocks or enables the IRQs */
+	reaper = thread_create("reaper", reaper_thread, NULL);
+	assert(reaper != NULL);
+
+	// The boot flow goes on as the idle thread
+	scheduler_set_priority(idle, THREAD_PRIORITY_IDLE);
+	scheduler_start(idle);
 }
 
 struct thread *thread_create(const char *name,
@@ -62,9 +152,19 @@ struct thread *thread_create(const char *name,
 	/* Initialize the thread attributes */
 	strzcpy(new_thread->name, ((name)?name:"[NONAME]"), THREAD_MAX_NAMELEN);
 	new_thread->state = THREAD_CREATED;
+	new_thread->scheduling_class = THREAD_CLASS_FIXED_PRIORITY;
+	new_thread->priority = THREAD_PRIORITY_DEFAULT;
+	new_thread->base_priority = THREAD_PRIORITY_DEFAULT;
+	new_thread->inherited_priority = THREAD_PRIORITY_IDLE;
+	TAILQ_INIT(&new_thread->held_mutexes);
+	new_thread->blocked_on = NULL;
+	memset(&new_thread->edf, 0, sizeof(struct thread_edf));
+	magazine_init(&new_thread->magazines);
+	x86_fpu_init(&new_thread->fpu);
+	memset(&new_thread->statistics, 0, sizeof(struct thread_statistics));
 
 	/* Allocate the stack for the new thread */
-	new_thread->stack_base_address	= (uint32_t)malloc(THREAD_KERNEL_STACK_SIZE);
+	new_thread->stack_base_address	= stack_alloc();
 	new_thread->stack_size		= THREAD_KERNEL_STACK_SIZE;
 
 	if (!new_thread->stack_base_address)
@@ -75,11 +175,12 @@ struct thread *thread_create(const char *name,
 			(cpu_kstate_function_arg1_t *)start_func,
 			(uint32_t)start_arg,
 			new_thread->stack_base_address,
-			new_thread->stack_size);
+			new_thread->stack_size,
+			thread_exit_routine, 0);
 
 	/* Add the thread in the global list */
 	X86_IRQs_DISABLE(flags);
-	TAILQ_INSERT_TAIL(&kernel_threads, new_thread, next);
+	TAILQ_INSERT_TAIL(&kernel_threads, new_thread, kernel_threads_next);
 	X86_IRQs_ENABLE(flags);
 
 
@@ -92,8 +193,113 @@ struct thread *thread_create(const char *name,
 
 undo_creation:
 	if (new_thread->stack_base_address)
-		free((uint32_t *)new_thread->stack_base_address);
+		stack_free(new_thread->stack_base_address);
 
 	free(new_thread);
 	return NULL;
 }
+
+/* Timer callback, from the timer interrupt */
+static void sleep_timeout(void *arg)
+{
+	scheduler_set_ready((struct thread *)arg);
+}
+
+void thread_sleep(uint64_t ns)
+{
+	struct timer timeout;
+	uint32_t flags;
+
+	timer_init(&timeout, sleep_timeout, thread_get_current(), TIMER_IRQ);
+
+	/* The timer can't expire before the thread is blocked */
+	X86_IRQs_DISABLE(flags);
+
+	timer_arm(&timeout, ns);
+	schedule_blocked();
+
+	X86_IRQs_ENABLE(flags);
+}
+
+void thread_exit(void)
+{
+	struct thread *current_thread;
+	uint32_t flags;
+
+	X86_IRQs_DISABLE(flags);
+	(void)flags;
+
+	current_thread = thread_get_current();
+	assert(TAILQ_EMPTY(&current_thread->held_mutexes));
+
+	/* Still on its stack: the reaper frees it once switched out */
+	TAILQ_REMOVE(&kernel_threads, current_thread, kernel_threads_next);
+	TAILQ_INSERT_TAIL(&zombie_threads, current_thread, kernel_threads_next);
+
+	schedule_exit(&reaper_wait);
+}
+
+/* Threads whose statistics are copied for a dump */
+#define THREAD_DUMP_MAX 16
+
+void thread_dump_statistics(void)
+{
+	static struct thread_statistics stats[THREAD_DUMP_MAX];
+	static char names[THREAD_DUMP_MAX][THREAD_MAX_NAMELEN];
+	struct thread *thr;
+	uint32_t flags, nb_threads = 0, i, bucket;
+	uint64_t now;
+
+	/* Copied at once, the threads may exit while they are printed */
+	X86_IRQs_DISABLE(flags);
+
+	now = clock_now_ns();
+
+	TAILQ_FOREACH(thr, &kernel_threads, kernel_threads_next)
+	{
+		if (nb_threads == THREAD_DUMP_MAX)
+			break;
+
+		stats[nb_threads] = thr->statistics;
+		strzcpy(names[nb_threads], thr->name, THREAD_MAX_NAMELEN);
+
+		/* Including the time slice in progress */
+		if (thr == g_current_thread)
+			stats[nb_threads].run_time +=
+				now - thr->statistics.running_since;
+
+		nb_threads++;
+	}
+
+	X86_IRQs_ENABLE(flags);
+
+	for (i = 0; i < nb_threads; i++)
+	{
+		printf("%s: %d ms, %d vol %d invol, %d wake ups, max %d us\n",
+			names[i],
+			(uint32_t)udiv64(stats[i].run_time, 1000000, NULL),
+			stats[i].voluntary_switches,
+			stats[i].involuntary_switches,
+			stats[i].wake_ups,
+			stats[i].max_latency / 1000);
+
+		if (!stats[i].wake_ups)
+			continue;
+
+		/* Non-empty buckets, as upper bound in us: count */
+		printf(" ");
+
+		for (bucket = 0; bucket < THREAD_LATENCY_BUCKETS; bucket++)
+		{
+			if (stats[i].latency_histogram[bucket])
+				printf(" %s%d:%d",
+					(bucket == THREAD_LATENCY_BUCKETS - 1)
+						? ">" : "<",
+					1 << ((bucket == THREAD_LATENCY_BUCKETS - 1)
+						? bucket - 1 : bucket),
+					stats[i].latency_histogram[bucket]);
+		}
+
+		printf("\n");
+	}
+}
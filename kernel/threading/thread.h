@@ -4,18 +4,40 @@
 #include <lib/queue.h>
 #include <lib/types.h>
 #include <arch/x86/threading/cpu-context.h>
+#include <arch/x86/threading/fpu.h>
 #include <memory/physical-memory.h>
+#include <memory/magazine.h>
+
+#include "stack.h"
+#include "timer.h"
 
 
 /*
- * The size of the stack of a kernel thread
+ * The maximal size of the stack of a kernel thread, its pages are
+ * committed on demand
  */
-#define THREAD_KERNEL_STACK_SIZE (1*X86_PAGE_SIZE)
+#define THREAD_KERNEL_STACK_SIZE STACK_MAX_SIZE
 
 #define THREAD_MAX_NAMELEN 32
 
+/*
+ * Fixed priorities, the highest number runs first
+ */
+#define THREAD_PRIORITY_LEVELS  32
+#define THREAD_PRIORITY_IDLE    0
+#define THREAD_PRIORITY_DEFAULT 16
+#define THREAD_PRIORITY_MAX     (THREAD_PRIORITY_LEVELS - 1)
+
+/*
+ * Scheduling classes, the EDF threads all run before the fixed
+ * priority ones
+ */
+#define THREAD_CLASS_FIXED_PRIORITY 0
+#define THREAD_CLASS_EDF            1
+
 /* Forward declaration */
 struct thread;
+struct mutex;
 
 
 /*
@@ -38,6 +60,64 @@ typedef enum
  */
 typedef void (*kernel_thread_start_routine_t)(void *arg);
 
+/*
+ * Wake up latencies are counted by powers of 2 of 1024 ns: below 1 us,
+ * 2 us, 4 us..., the last bucket takes the longer ones
+ */
+#define THREAD_LATENCY_BUCKETS 16
+
+/*
+ * Scheduling statistics, in nanoseconds of the monotonic clock
+ */
+struct thread_statistics
+{
+	/* Made ready, and woken up rather than preempted */
+	uint64_t ready_since;
+	bool_t   woken_up;
+
+	/* Elected last, and CPU time until it was switched out last */
+	uint64_t running_since;
+	uint64_t run_time;
+
+	/* Blocked or exited, or preempted and at the end of a time slice */
+	uint32_t voluntary_switches;
+	uint32_t involuntary_switches;
+
+	/* From the wake up to the election */
+	uint32_t wake_ups;
+	uint32_t max_latency;
+	uint32_t latency_histogram[THREAD_LATENCY_BUCKETS];
+};
+
+/*
+ * Earliest deadline first parameters and state, all in timer ticks.
+ * A job is released every period, it may run for budget ticks and
+ * should complete before its deadline.
+ */
+struct thread_edf
+{
+	uint32_t period;
+	uint32_t budget;
+	uint32_t relative_deadline;
+
+	/* Current job */
+	uint32_t absolute_deadline;
+	uint32_t remaining_budget;
+	bool_t   job_completed;
+
+	/* Periodic, releases the jobs from the timer interrupt */
+	struct timer release_timer;
+
+	/* Blocked until the next release: job completed or budget exhausted */
+	bool_t   waiting_release;
+
+	uint32_t deadline_misses;
+	uint32_t budget_overruns;
+
+	/* Global list of the EDF threads */
+	TAILQ_ENTRY(thread) edf_threads_next;
+};
+
 struct thread
 {
 	/* Kernel stack parameters */
@@ -48,9 +128,34 @@ struct thread
 
 	thread_state state;
 
+	uint32_t scheduling_class;
+	struct thread_edf edf;
+
+	/* Effective priority: the highest of its own and of the inherited
+	 * one, from the threads waiting for its mutexes */
+	uint32_t priority;
+	uint32_t base_priority;
+	uint32_t inherited_priority;
+
+	/* Priority inheritance mutexes held, and the one waited for */
+	TAILQ_HEAD(, mutex) held_mutexes;
+	struct mutex *blocked_on;
+
 	struct cpu_state *cpu_state;
 
+	/* FPU and SSE registers, saved only once another thread uses them */
+	struct x86_fpu_state fpu;
+
+	struct thread_statistics statistics;
+
+	/* Caches of small objects, only used by the thread itself */
+	struct magazines magazines;
+
+	/* Ready queue or wait queue the thread is in */
 	TAILQ_ENTRY(thread) next;
+
+	/* Global list of kernel threads */
+	TAILQ_ENTRY(thread) kernel_threads_next;
 };
 
 
@@ -59,6 +164,7 @@ struct thread
  *
  * Initialize the primary kernel thread so that it can be handled
  * the same way as an ordinary thread created by thread_create().
+ * The scheduler must be setup first.
  */
 void threading_setup(void);
 
@@ -70,4 +176,23 @@ inline void thread_set_current(struct thread *current_thread);
 
 struct thread *thread_get_current(void);
 
+/**
+ * Terminate the current thread, the same as returning from its start
+ * function. Its stack and structure are freed by the "reaper" thread.
+ */
+void thread_exit(void) __attribute__((noreturn));
+
+/**
+ * Print the scheduling statistics of the threads: CPU time, switches and
+ * wake up latency histogram
+ */
+void thread_dump_statistics(void);
+
+/**
+ * Block the current thread for at least the given duration
+ *
+ * @param ns Duration in nanoseconds, rounded up to whole ticks
+ */
+void thread_sleep(uint64_t ns);
+
 #endif // _THREAD_H_
@@ -0,0 +1,350 @@
+#include <lib/libc.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "timer.h"
+#include "thread.h"
+#include "scheduler.h"
+#include "wait-queue.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/* Index of the slot of a tick on a level */
+#define SLOT_INDEX(tick, level) \
+	(((tick) >> (TIMER_WHEEL_BITS * (level))) & TIMER_WHEEL_MASK)
+
+/* Tick comparison which survives the wrap around of the counter */
+#define TICK_BEFORE(a, b) ((int32_t)((a) - (b)) < 0)
+
+TAILQ_HEAD(timer_slot, timer);
+
+static struct timer_slot wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+/* Non-empty slots of each level. The slots are only touched when their
+ * bit is set, before the setup too. */
+static uint64_t slot_bitmaps[TIMER_WHEEL_LEVELS];
+
+/* Next tick to expire, the armed timers all expire at or after it */
+static uint32_t wheel_time;
+
+/* Expired timers whose callback waits for the "timers" thread */
+static TAILQ_HEAD(, timer) deferred_timers;
+static struct wait_queue deferred_wait;
+
+/* The one-shot timer: armed until it expires, either for the next tick or
+ * up to the next expiry */
+static bool_t   one_shot_armed;
+static bool_t   one_shot_tick;
+static uint32_t one_shot_expires;
+
+
+static void insert_timer(struct timer *t)
+{
+	uint32_t delta, level = 0;
+
+	/* The wheel only spans TIMER_MAX_DELAY ticks */
+	delta = t->expires - wheel_time;
+
+	if (delta > TIMER_MAX_DELAY)
+	{
+		t->expires = wheel_time + TIMER_MAX_DELAY;
+		delta      = TIMER_MAX_DELAY;
+	}
+
+	while (level < TIMER_WHEEL_LEVELS - 1
+		&& delta >= 1UL << (TIMER_WHEEL_BITS * (level + 1)))
+		level++;
+
+	t->level = level;
+	t->index = SLOT_INDEX(t->expires, level);
+	t->armed = TRUE;
+
+	if (!(slot_bitmaps[level] & (1ULL << t->index)))
+		TAILQ_INIT(&wheel[level][t->index]);
+
+	TAILQ_INSERT_TAIL(&wheel[level][t->index], t, wheel_next);
+	slot_bitmaps[level] |= 1ULL << t->index;
+}
+
+static void unlink_timer(struct timer *t)
+{
+	struct timer_slot *slot = &wheel[t->level][t->index];
+
+	TAILQ_REMOVE(slot, t, wheel_next);
+
+	if (TAILQ_EMPTY(slot))
+		slot_bitmaps[t->level] &= ~(1ULL << t->index);
+
+	t->armed = FALSE;
+}
+
+/* Move the timers of a slot to the lower levels, now that they are near */
+static uint32_t cascade(uint32_t level, uint32_t index)
+{
+	struct timer *t;
+
+	if (slot_bitmaps[level] & (1ULL << index))
+	{
+		while ((t = TAILQ_FIRST(&wheel[level][index])) != NULL)
+		{
+			unlink_timer(t);
+			insert_timer(t);
+		}
+	}
+
+	return index;
+}
+
+static void expire_timer(struct timer *t)
+{
+	unlink_timer(t);
+
+	if (t->period)
+	{
+		t->expires += t->period;
+		insert_timer(t);
+	}
+
+	if (t->flags & TIMER_IRQ)
+	{
+		t->callback(t->arg);
+	}
+	else if (!t->pending)
+	{
+		/* A periodic callback still pending misses this expiry */
+		t->pending = TRUE;
+		TAILQ_INSERT_TAIL(&deferred_timers, t, deferred_next);
+		wait_queue_wake_one(&deferred_wait);
+	}
+}
+
+void timer_wheel_run(void)
+{
+	uint32_t now = timer_get_ticks(), index, level;
+	struct timer *t;
+
+	one_shot_armed = FALSE;
+
+	while (!TICK_BEFORE(now, wheel_time))
+	{
+		index = wheel_time & TIMER_WHEEL_MASK;
+
+		/* The first level wrapped around: the next slot of the second
+		 * one comes near, and so on */
+		for (level = 1; level < TIMER_WHEEL_LEVELS && index == 0; level++)
+			index = cascade(level, SLOT_INDEX(wheel_time, level));
+
+		index = wheel_time & TIMER_WHEEL_MASK;
+
+		if (slot_bitmaps[0] & (1ULL << index))
+		{
+			while ((t = TAILQ_FIRST(&wheel[0][index])) != NULL)
+				expire_timer(t);
+		}
+
+		wheel_time++;
+	}
+}
+
+/* Index of the lowest bit set, the bitmap must not be empty */
+static inline uint32_t lowest_bit(uint64_t bitmap)
+{
+	if ((uint32_t)bitmap)
+		return __builtin_ctz((uint32_t)bitmap);	/* bsf */
+
+	return 32 + __builtin_ctz((uint32_t)(bitmap >> 32));
+}
+
+/* Ticks from now until the next expiry or cascade, if any */
+static uint32_t ticks_until_next_expiry(uint32_t now)
+{
+	uint32_t index = wheel_time & TIMER_WHEEL_MASK, distance, level;
+	uint64_t rotated;
+	bool_t   upper_levels = FALSE;
+
+	for (level = 1; level < TIMER_WHEEL_LEVELS; level++)
+		upper_levels |= (slot_bitmaps[level] != 0);
+
+	if (!slot_bitmaps[0] && !upper_levels)
+		return TIMER_NO_EVENT;
+
+	/* The farthest: the next wrap around of the first level */
+	distance = (TIMER_WHEEL_SLOTS - index) & TIMER_WHEEL_MASK;
+
+	if (slot_bitmaps[0])
+	{
+		/* First non-empty slot, circularly from the current one */
+		rotated = slot_bitmaps[0] >> index;
+
+		if (index)
+			rotated |= slot_bitmaps[0] << (TIMER_WHEEL_SLOTS - index);
+
+		if (!upper_levels || lowest_bit(rotated) < distance)
+			distance = lowest_bit(rotated);
+	}
+
+	distance = wheel_time + distance - now;
+
+	return distance ? distance : 1;
+}
+
+void timer_wheel_program(bool_t tick_needed)
+{
+	uint32_t now, delay;
+
+	if (tick_needed)
+	{
+		if (!one_shot_armed || !one_shot_tick)
+			timer_set_next_event(1);
+
+		one_shot_armed = TRUE;
+		one_shot_tick  = TRUE;
+		return;
+	}
+
+	if (one_shot_armed)
+		return;
+
+	/* Not armed: the counter isn't read, this is cheap */
+	now = timer_get_ticks();
+
+	delay = ticks_until_next_expiry(now);
+	timer_set_next_event(delay);
+
+	if (delay == TIMER_NO_EVENT)
+		delay = TIMER_MAX_DELAY;
+
+	one_shot_armed   = TRUE;
+	one_shot_tick    = FALSE;
+	one_shot_expires = now + delay;
+}
+
+void timer_init(struct timer *t, timer_callback_t callback, void *arg,
+		uint32_t flags)
+{
+	t->callback = callback;
+	t->arg      = arg;
+	t->flags    = flags;
+	t->period   = 0;
+	t->armed    = FALSE;
+	t->pending  = FALSE;
+}
+
+void timer_arm_ticks(struct timer *t, uint32_t delay, uint32_t period)
+{
+	uint32_t flags, now;
+
+	X86_IRQs_DISABLE(flags);
+
+	if (t->armed)
+		unlink_timer(t);
+
+	now = timer_get_ticks();
+
+	t->expires = now + (delay ? delay : 1);
+	t->period  = period;
+	insert_timer(t);
+
+	/* Expiring before the armed one-shot: bring it forward */
+	if (one_shot_armed && !one_shot_tick
+		&& TICK_BEFORE(t->expires, one_shot_expires))
+	{
+		timer_set_next_event(t->expires - now);
+		one_shot_expires = t->expires;
+	}
+
+	X86_IRQs_ENABLE(flags);
+}
+
+/* Nanoseconds to ticks, rounded up */
+static uint32_t ns_to_ticks(uint64_t ns)
+{
+	uint32_t remainder;
+	uint64_t ticks = udiv64(ns, TIMER_NS_PER_TICK, &remainder);
+
+	if (remainder)
+		ticks++;
+
+	return (ticks > TIMER_MAX_DELAY) ? TIMER_MAX_DELAY : (uint32_t)ticks;
+}
+
+void timer_arm(struct timer *t, uint64_t delay_ns)
+{
+	/* Plus the tick in progress, partly elapsed */
+	timer_arm_ticks(t, ns_to_ticks(delay_ns) + 1, 0);
+}
+
+void timer_arm_periodic(struct timer *t, uint64_t period_ns)
+{
+	uint32_t period = ns_to_ticks(period_ns);
+
+	if (!period)
+		period = 1;
+
+	timer_arm_ticks(t, period, period);
+}
+
+bool_t timer_cancel(struct timer *t)
+{
+	uint32_t flags;
+	bool_t was_active;
+
+	X86_IRQs_DISABLE(flags);
+
+	was_active = t->armed || t->pending;
+
+	if (t->armed)
+		unlink_timer(t);
+
+	if (t->pending)
+	{
+		TAILQ_REMOVE(&deferred_timers, t, deferred_next);
+		t->pending = FALSE;
+	}
+
+	t->period = 0;
+
+	X86_IRQs_ENABLE(flags);
+
+	return was_active;
+}
+
+/* Runs the callbacks of the expired timers, out of the interrupt */
+static void timers_thread(void *arg)
+{
+	struct timer *t;
+	uint32_t flags;
+
+	(void)arg;
+
+	while (1)
+	{
+		X86_IRQs_DISABLE(flags);
+
+		while (TAILQ_EMPTY(&deferred_timers))
+			wait_queue_sleep(&deferred_wait);
+
+		t = TAILQ_FIRST(&deferred_timers);
+		TAILQ_REMOVE(&deferred_timers, t, deferred_next);
+		t->pending = FALSE;
+
+		X86_IRQs_ENABLE(flags);
+
+		t->callback(t->arg);
+	}
+}
+
+void timer_wheel_setup(void)
+{
+	struct thread *thr;
+
+	TAILQ_INIT(&deferred_timers);
+	wait_queue_init(&deferred_wait);
+
+	/* Nothing armed yet, skip the ticks elapsed since the boot */
+	wheel_time = timer_get_ticks();
+
+	thr = thread_create("timers", timers_thread, NULL);
+	assert(thr != NULL);
+
+	scheduler_set_priority(thr, THREAD_PRIORITY_MAX);
+}
@@ -0,0 +1,99 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+/**
+ * @file timer.h
+ * @license MIT License
+ *
+ * Software timers, on a hierarchical timing wheel.
+ *
+ * The wheel has TIMER_WHEEL_LEVELS levels of 64 slots, one tick per slot
+ * on the first level and 64 times more per slot on each next level.
+ * Arming and cancelling a timer are O(1). When the first level wraps
+ * around, the timers of the current slot of the next level are cascaded
+ * down, so that the expiry is O(1) amortized.
+ *
+ * The callbacks run in the "timers" kernel thread, at the highest fixed
+ * priority, unless the timer is flagged TIMER_IRQ: the callback then runs
+ * from the timer interrupt and must be short.
+ */
+
+#include <lib/queue.h>
+#include <lib/types.h>
+#include <arch/x86-pc/timer/pit.h>
+
+#define TIMER_WHEEL_BITS   6
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/** Longest delay, in ticks: longer ones are shortened to it */
+#define TIMER_MAX_DELAY    ((1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+/** The callback is run by the timer interrupt */
+#define TIMER_IRQ          0x1
+
+typedef void (*timer_callback_t)(void *arg);
+
+struct timer
+{
+	/* Expiry tick, and period in ticks for the periodic timers */
+	uint32_t expires;
+	uint32_t period;
+
+	timer_callback_t callback;
+	void *arg;
+	uint32_t flags;
+
+	/* In a slot of the wheel */
+	bool_t   armed;
+	uint8_t  level;
+	uint8_t  index;
+	TAILQ_ENTRY(timer) wheel_next;
+
+	/* Expired, waiting for the "timers" thread to run the callback */
+	bool_t   pending;
+	TAILQ_ENTRY(timer) deferred_next;
+};
+
+/** Start the thread running the callbacks, threading must be setup */
+void timer_wheel_setup(void);
+
+/**
+ * Expire the timers up to the current tick. Called from the timer
+ * interrupt with IRQs disabled, the one-shot timer is no longer armed.
+ */
+void timer_wheel_run(void);
+
+/**
+ * Arm the one-shot timer for the next expiry, or for the next tick when
+ * the running thread needs the time slicing. Called by the scheduler with
+ * IRQs disabled.
+ */
+void timer_wheel_program(bool_t tick_needed);
+
+/** Initialize a disarmed timer */
+void timer_init(struct timer *t, timer_callback_t callback, void *arg,
+		uint32_t flags);
+
+/**
+ * Arm a timer to expire once, after at least the given delay. A timer
+ * already armed is moved.
+ *
+ * @param delay_ns Delay in nanoseconds, rounded up to whole ticks
+ */
+void timer_arm(struct timer *t, uint64_t delay_ns);
+
+/** Arm a timer to expire every period, the first time after one period */
+void timer_arm_periodic(struct timer *t, uint64_t period_ns);
+
+/** Same as timer_arm() and timer_arm_periodic(), in ticks */
+void timer_arm_ticks(struct timer *t, uint32_t delay, uint32_t period);
+
+/**
+ * Disarm a timer. A callback already running is not waited for.
+ *
+ * @return TRUE if the timer was armed or its callback pending
+ */
+bool_t timer_cancel(struct timer *t);
+
+#endif // _TIMER_H_
@@ -0,0 +1,56 @@
+#include <lib/libc.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "wait-queue.h"
+#include "scheduler.h"
+
+void wait_queue_init(struct wait_queue *wq)
+{
+	TAILQ_INIT(&wq->waiting_threads);
+}
+
+void wait_queue_sleep(struct wait_queue *wq)
+{
+	uint32_t flags;
+	struct thread *current_thread;
+
+	X86_IRQs_DISABLE(flags);
+
+	current_thread = thread_get_current();
+	TAILQ_INSERT_TAIL(&wq->waiting_threads, current_thread, next);
+
+	/* Returns once woken up and elected again */
+	schedule_blocked();
+
+	X86_IRQs_ENABLE(flags);
+}
+
+uint32_t wait_queue_wake_one(struct wait_queue *wq)
+{
+	uint32_t flags;
+	struct thread *thr;
+
+	X86_IRQs_DISABLE(flags);
+
+	thr = TAILQ_FIRST(&wq->waiting_threads);
+
+	if (thr)
+	{
+		TAILQ_REMOVE(&wq->waiting_threads, thr, next);
+		scheduler_set_ready(thr);
+	}
+
+	X86_IRQs_ENABLE(flags);
+
+	return (thr != NULL);
+}
+
+uint32_t wait_queue_wake_all(struct wait_queue *wq)
+{
+	uint32_t nb_woken_up = 0;
+
+	while (wait_queue_wake_one(wq))
+		nb_woken_up++;
+
+	return nb_woken_up;
+}
@@ -0,0 +1,74 @@
+#ifndef _WAIT_QUEUE_H_
+#define _WAIT_QUEUE_H_
+
+/**
+ * @file wait-queue.h
+ * @license MIT License
+ *
+ * Queues of threads blocked until an event happens
+ */
+
+#include <lib/queue.h>
+#include <lib/types.h>
+#include <arch/x86/interrupts/irq.h>
+
+#include "thread.h"
+
+struct wait_queue
+{
+	TAILQ_HEAD(, thread) waiting_threads;
+};
+
+/** Initialize an empty wait queue */
+void wait_queue_init(struct wait_queue *wq);
+
+/**
+ * Block the current thread in the wait queue until it is woken up.
+ *
+ * The condition being waited for must be checked with IRQs disabled
+ * and the caller must go to sleep without enabling them in between,
+ * otherwise a wake up coming from an interrupt handler could be lost.
+ *
+ * @param wq The wait queue to sleep in
+ */
+void wait_queue_sleep(struct wait_queue *wq);
+
+/**
+ * Wake up the oldest thread of the wait queue. Can be called from an
+ * interrupt handler.
+ *
+ * @param wq The wait queue
+ * @return The number of woken up threads: 0 or 1
+ */
+uint32_t wait_queue_wake_one(struct wait_queue *wq);
+
+/**
+ * Wake up every thread of the wait queue. Can be called from an
+ * interrupt handler.
+ *
+ * @param wq The wait queue
+ * @return The number of woken up threads
+ */
+uint32_t wait_queue_wake_all(struct wait_queue *wq);
+
+/**
+ * Sleep in the wait queue until the condition is true. The condition is
+ * evaluated with IRQs disabled, again after each wake up, so that a wake
+ * up from an interrupt handler between the check and the sleep isn't lost.
+ *
+ * @param wq The wait queue to sleep in
+ * @param condition Expression evaluated each time the thread wakes up
+ */
+#define wait_event(wq, condition)					\
+	({								\
+		uint32_t __wait_flags;					\
+									\
+		X86_IRQs_DISABLE(__wait_flags);				\
+									\
+		while (!(condition))					\
+			wait_queue_sleep(wq);				\
+									\
+		X86_IRQs_ENABLE(__wait_flags);				\
+	})
+
+#endif // _WAIT_QUEUE_H_